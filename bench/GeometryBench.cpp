@@ -0,0 +1,571 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "geometry/Utils.h"
+#include "geometry/Delaunay.h"
+#include "geometry/Triangulation.h"
+#include "geometry/TaskPool.h"
+#include "geometry/Voronoi.h"
+#include "geometry/CellLocator.h"
+#include "geometry/EdgeGrid.h"
+#include "primitives/BallPhysics.h"
+
+// Run with --benchmark_format=json (or build VoronoiseBenchReport) for machine-readable output.
+// Every stage reports sites/s (or items/s), allocations per iteration and the peak number of
+// bytes live at once above what was allocated before the stage started.
+
+namespace
+{
+   std::atomic<size_t> allocationCount{0};
+   std::atomic<size_t> liveBytes{0};
+   std::atomic<size_t> peakBytes{0};
+
+   // Every block carries its size in front so the unsized deletes can account for it
+   constexpr size_t headerSize = alignof(std::max_align_t);
+
+   void *countedAlloc(size_t size)
+   {
+      auto *block = static_cast<unsigned char *>(std::malloc(size + headerSize));
+      if (block == nullptr)
+         throw std::bad_alloc();
+
+      *reinterpret_cast<size_t *>(block) = size;
+      allocationCount.fetch_add(1, std::memory_order_relaxed);
+      size_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+      size_t peak = peakBytes.load(std::memory_order_relaxed);
+      while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+      {
+      }
+      return block + headerSize;
+   }
+
+   void countedFree(void *ptr)
+   {
+      if (ptr == nullptr)
+         return;
+
+      auto *block = static_cast<unsigned char *>(ptr) - headerSize;
+      liveBytes.fetch_sub(*reinterpret_cast<size_t *>(block), std::memory_order_relaxed);
+      std::free(block);
+   }
+
+   // Brackets the timed loop of one benchmark and reports its allocation counters
+   class AllocationScope
+   {
+   public:
+      AllocationScope()
+      {
+         baseline = liveBytes.load();
+         peakBytes.store(baseline);
+         startCount = allocationCount.load();
+      }
+
+      void report(benchmark::State &state) const
+      {
+         double iterations = static_cast<double>(std::max<benchmark::IterationCount>(state.iterations(), 1));
+         state.counters["allocs"] = static_cast<double>(allocationCount.load() - startCount) / iterations;
+         state.counters["peakBytes"] = static_cast<double>(peakBytes.load() - baseline);
+      }
+
+   private:
+      size_t baseline = 0;
+      size_t startCount = 0;
+   };
+
+   enum class Distribution
+   {
+      Uniform,
+      Clustered,
+      Grid,
+      NearCollinear
+   };
+
+   const char *distributionName(Distribution distribution)
+   {
+      switch (distribution)
+      {
+      case Distribution::Uniform:
+         return "uniform";
+      case Distribution::Clustered:
+         return "clustered";
+      case Distribution::Grid:
+         return "grid";
+      case Distribution::NearCollinear:
+         return "near-collinear";
+      }
+      return "";
+   }
+
+   const GeoUtils::BBox bounds{0.0, 0.0, 1000.0, 1000.0};
+   const GeoUtils::BBox innerBounds{250.0, 250.0, 750.0, 750.0};
+
+   // Deterministic so runs from different releases see the same input
+   std::vector<GeoUtils::Point> makeSites(size_t count, Distribution distribution)
+   {
+      std::mt19937 rng(1234);
+      std::uniform_real_distribution<double> unit(0.0, 1.0);
+      std::vector<GeoUtils::Point> sites;
+      sites.reserve(count);
+
+      switch (distribution)
+      {
+      case Distribution::Uniform:
+         for (size_t i = 0; i < count; ++i)
+            sites.push_back({1000.0 * unit(rng), 1000.0 * unit(rng)});
+         break;
+
+      case Distribution::Clustered:
+      {
+         // A handful of tight gaussian blobs, the way sites bunch up when drawn by hand
+         std::vector<GeoUtils::Point> centres;
+         for (int c = 0; c < 8; ++c)
+            centres.push_back({100.0 + 800.0 * unit(rng), 100.0 + 800.0 * unit(rng)});
+
+         std::normal_distribution<double> spread(0.0, 25.0);
+         for (size_t i = 0; i < count; ++i)
+         {
+            const auto &centre = centres[i % centres.size()];
+            sites.push_back({std::clamp(centre.x + spread(rng), 0.0, 1000.0), std::clamp(centre.y + spread(rng), 0.0, 1000.0)});
+         }
+         break;
+      }
+
+      case Distribution::Grid:
+      {
+         // Every cell of a square grid is co-circular, the worst case for the incircle test
+         auto side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+         double step = 1000.0 / static_cast<double>(side + 1);
+         for (size_t i = 0; i < count; ++i)
+            sites.push_back({step * static_cast<double>(i % side + 1), step * static_cast<double>(i / side + 1)});
+         break;
+      }
+
+      case Distribution::NearCollinear:
+         for (size_t i = 0; i < count; ++i)
+            sites.push_back({1000.0 * unit(rng), 500.0 + 1e-6 * (unit(rng) - 0.5)});
+         break;
+      }
+
+      return sites;
+   }
+
+   Distribution distributionArg(const benchmark::State &state)
+   {
+      return static_cast<Distribution>(state.range(1));
+   }
+}
+
+void *operator new(size_t size) { return countedAlloc(size); }
+void *operator new[](size_t size) { return countedAlloc(size); }
+void operator delete(void *ptr) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr) noexcept { countedFree(ptr); }
+void operator delete(void *ptr, size_t) noexcept { countedFree(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { countedFree(ptr); }
+
+static void BM_Triangulate(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), distributionArg(state));
+
+   AllocationScope scope;
+   for (auto _ : state)
+      benchmark::DoNotOptimize(Delaunay::triangulate(sites));
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+   state.SetLabel(distributionName(distributionArg(state)));
+}
+
+// Uniform sites split across a pool of the given size; the mesh is the same for every size
+static void BM_TriangulateThreads(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), Distribution::Uniform);
+   GeoUtils::TaskPool pool(static_cast<int>(state.range(1)));
+
+   AllocationScope scope;
+   for (auto _ : state)
+      benchmark::DoNotOptimize(Delaunay::triangulateMesh(sites, &pool));
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_GetDiagram(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), distributionArg(state));
+   auto mesh = Delaunay::triangulateMesh(sites);
+
+   AllocationScope scope;
+   for (auto _ : state)
+      benchmark::DoNotOptimize(Voronoi::getDiagram(mesh, bounds));
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+   state.SetLabel(distributionName(distributionArg(state)));
+}
+
+// Cells of uniform sites built across a pool of the given size
+static void BM_GetDiagramThreads(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), Distribution::Uniform);
+   auto mesh = Delaunay::triangulateMesh(sites);
+   GeoUtils::TaskPool pool(static_cast<int>(state.range(1)));
+
+   AllocationScope scope;
+   for (auto _ : state)
+      benchmark::DoNotOptimize(Voronoi::getDiagram(mesh, bounds, &pool));
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// What the geometry worker does for a pattern of new sites, with the triangulation, mesh, diagram
+// and workspace kept from one rebuild to the next. Arenas measure what they lack on the first
+// untimed rebuild and take their grown blocks on the second.
+static void BM_Rebuild(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), Distribution::Uniform);
+   GeoUtils::TaskPool pool(static_cast<int>(state.range(1)));
+   Delaunay::Triangulation triangulation;
+   GeoUtils::Mesh mesh;
+   Voronoi::Diagram diagram;
+   Voronoi::Workspace workspace;
+   GeoUtils::Arena meshScratch;
+   auto rebuild = [&]
+   {
+      triangulation.build(sites, &pool);
+      triangulation.getMesh(mesh, meshScratch);
+      Voronoi::getDiagram(mesh, bounds, diagram, workspace, &pool);
+   };
+   rebuild();
+   rebuild();
+
+   AllocationScope scope;
+   for (auto _ : state)
+   {
+      rebuild();
+      benchmark::DoNotOptimize(diagram.cellVertices.data());
+   }
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_GetCells(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), distributionArg(state));
+   auto mesh = Delaunay::triangulateMesh(sites);
+
+   AllocationScope scope;
+   for (auto _ : state)
+      benchmark::DoNotOptimize(Voronoi::getCells(mesh, bounds));
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+   state.SetLabel(distributionName(distributionArg(state)));
+}
+
+static void BM_GetEdges(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), distributionArg(state));
+   auto mesh = Delaunay::triangulateMesh(sites);
+
+   AllocationScope scope;
+   for (auto _ : state)
+      benchmark::DoNotOptimize(Voronoi::getEdges(mesh, bounds));
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+   state.SetLabel(distributionName(distributionArg(state)));
+}
+
+// Re-clips every finished cell against a smaller box; items are polygons
+static void BM_ClipPolygon(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), distributionArg(state));
+   std::vector<std::vector<GeoUtils::Point>> polygons;
+   for (auto &kv : Voronoi::getCells(Delaunay::triangulateMesh(sites), bounds))
+      polygons.push_back(std::move(kv.second.vertices));
+
+   // Buffers are reused across polygons, as the diagram builder does; sized once before timing
+   std::pmr::vector<GeoUtils::Point> clipped;
+   GeoUtils::ClipScratch scratch;
+   for (const auto &polygon : polygons)
+      GeoUtils::clipPolygon(polygon.data(), polygon.size(), innerBounds, clipped, scratch);
+
+   AllocationScope scope;
+   for (auto _ : state)
+   {
+      for (const auto &polygon : polygons)
+      {
+         clipped.clear();
+         GeoUtils::clipPolygon(polygon.data(), polygon.size(), innerBounds, clipped, scratch);
+         benchmark::DoNotOptimize(clipped.data());
+      }
+   }
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(polygons.size()));
+   state.SetLabel(distributionName(distributionArg(state)));
+}
+
+// The same polygons as one flat list, clipped in a single call
+static void BM_ClipPolygons(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), distributionArg(state));
+   auto diagram = Voronoi::getDiagram(Delaunay::triangulateMesh(sites), bounds);
+   std::vector<GeoUtils::Point> vertices;
+   std::vector<int> offsets = {0};
+   for (size_t c = 0; c < diagram.numCells(); ++c)
+   {
+      for (int k = 0; k < diagram.cellSize(c); ++k)
+         vertices.push_back(diagram.cellVertex(c, k));
+      offsets.push_back(static_cast<int>(vertices.size()));
+   }
+
+   std::pmr::vector<GeoUtils::Point> outVertices;
+   std::pmr::vector<int> outOffsets;
+   GeoUtils::ClipScratch scratch;
+   GeoUtils::clipPolygons(vertices, offsets, innerBounds, outVertices, outOffsets, scratch);
+
+   AllocationScope scope;
+   for (auto _ : state)
+   {
+      GeoUtils::clipPolygons(vertices, offsets, innerBounds, outVertices, outOffsets, scratch);
+      benchmark::DoNotOptimize(outVertices.data());
+   }
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(diagram.numCells()));
+   state.SetLabel(distributionName(distributionArg(state)));
+}
+
+// Re-clips every Voronoi edge against a smaller box; items are edges
+static void BM_ClipEdge(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), distributionArg(state));
+   auto edges = Voronoi::getEdges(Delaunay::triangulateMesh(sites), bounds);
+
+   AllocationScope scope;
+   for (auto _ : state)
+   {
+      for (auto edge : edges)
+      {
+         benchmark::DoNotOptimize(GeoUtils::clipEdge(edge, innerBounds));
+         benchmark::DoNotOptimize(edge);
+      }
+   }
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(edges.size()));
+   state.SetLabel(distributionName(distributionArg(state)));
+}
+
+// The same edges clipped in one batch; the copy back each iteration is part of the timing
+static void BM_ClipEdges(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), distributionArg(state));
+   auto edges = Voronoi::getEdges(Delaunay::triangulateMesh(sites), bounds);
+   std::vector<GeoUtils::Edge> batch(edges.size());
+
+   AllocationScope scope;
+   for (auto _ : state)
+   {
+      std::copy(edges.begin(), edges.end(), batch.begin());
+      benchmark::DoNotOptimize(GeoUtils::clipEdges(batch.data(), batch.size(), innerBounds));
+   }
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(edges.size()));
+   state.SetLabel(distributionName(distributionArg(state)));
+}
+
+// Scattered queries start from the grid; coherent ones, like a moving ball, from the last cell
+static void BM_FindCell(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), distributionArg(state));
+   Voronoi::CellLocator locator;
+   locator.build(Delaunay::triangulateMesh(sites));
+   const bool coherent = state.range(2) != 0;
+
+   std::mt19937 rng(11);
+   std::uniform_real_distribution<double> x(bounds.minX, bounds.maxX), y(bounds.minY, bounds.maxY);
+   std::uniform_real_distribution<double> step(-0.5, 0.5);
+   std::vector<GeoUtils::Point> queries(4096);
+   GeoUtils::Point p{x(rng), y(rng)};
+   for (auto &query : queries)
+   {
+      if (coherent)
+      {
+         p.x = std::clamp(p.x + step(rng), bounds.minX, bounds.maxX);
+         p.y = std::clamp(p.y + step(rng), bounds.minY, bounds.maxY);
+      }
+      else
+         p = {x(rng), y(rng)};
+      query = p;
+   }
+
+   AllocationScope scope;
+   int cell = -1;
+   for (auto _ : state)
+   {
+      for (const auto &query : queries)
+         cell = locator.findCell(query, coherent ? cell : -1);
+      benchmark::DoNotOptimize(cell);
+   }
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(queries.size()));
+   state.SetLabel(distributionName(distributionArg(state)));
+}
+
+// One 64-sample block at 48 kHz for a crowd of balls in the cells of a diagram
+static void BM_BallPhysics(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), Distribution::Uniform);
+   auto edges = Voronoi::getEdges(Delaunay::triangulateMesh(sites), bounds);
+   edges.push_back({{bounds.minX, bounds.minY}, {bounds.maxX, bounds.minY}});
+   edges.push_back({{bounds.maxX, bounds.minY}, {bounds.maxX, bounds.maxY}});
+   edges.push_back({{bounds.maxX, bounds.maxY}, {bounds.minX, bounds.maxY}});
+   edges.push_back({{bounds.minX, bounds.maxY}, {bounds.minX, bounds.minY}});
+   GeoUtils::EdgeGrid grid;
+   grid.build(edges, bounds);
+
+   const int numBalls = static_cast<int>(state.range(1));
+   BallPhysics physics;
+   physics.prepare(48000.0, numBalls);
+   std::mt19937 rng(13);
+   std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+   for (int i = 0; i < numBalls; ++i)
+   {
+      Ball ball;
+      ball.position = sites[static_cast<size_t>(i) % sites.size()];
+      ball.radius = 1.f;
+      ball.angle = angle(rng);
+      ball.velocity = 2000.f;
+      ball.timeLeftAlive = 1e6f;
+      physics.launch(ball);
+   }
+
+   std::vector<BallNote> notes;
+   notes.reserve(static_cast<size_t>(numBalls) * 4);
+   AllocationScope scope;
+   for (auto _ : state)
+   {
+      notes.clear();
+      physics.process(64, grid, notes);
+      benchmark::DoNotOptimize(notes.data());
+   }
+   scope.report(state);
+
+   state.SetItemsProcessed(state.iterations() * numBalls);
+}
+
+// One relaxation step of a few thousand sites: each moves halfway to its cell's centroid,
+// then the mesh and diagram are brought up to date. The sites go back and forth between two
+// neighbouring steps, moved in place by edge flips or triangulated from scratch.
+static void BM_RelaxStep(benchmark::State &state)
+{
+   auto sites = makeSites(static_cast<size_t>(state.range(0)), Distribution::Uniform);
+   const int64_t mode = state.range(1); // full rebuild, one moveSite per site, or moveSites
+   std::vector<int> ids(sites.size());
+   std::iota(ids.begin(), ids.end(), 0);
+
+   // A few full steps first, as the sites of a running relaxation are already spread out
+   std::vector<GeoUtils::Point> centroids, relaxed = sites;
+   std::vector<double> areas;
+   for (int step = 0; step < 4; ++step)
+   {
+      sites = relaxed;
+      Voronoi::getCentroids(Voronoi::getDiagram(Delaunay::triangulateMesh(sites), bounds), centroids, areas);
+      for (size_t i = 0; i < sites.size(); ++i)
+         relaxed[i] = sites[i] + (centroids[i] - sites[i]) * 0.5;
+   }
+
+   Delaunay::Triangulation triangulation(sites);
+   GeoUtils::Mesh mesh;
+   Voronoi::Diagram diagram;
+   Voronoi::Workspace workspace;
+   GeoUtils::Arena meshScratch;
+   bool forward = true;
+   for (auto _ : state)
+   {
+      const auto &to = forward ? relaxed : sites;
+      if (mode == 0)
+      {
+         triangulation.build(to);
+      }
+      else if (mode == 1)
+      {
+         for (size_t i = 0; i < to.size(); ++i)
+            triangulation.moveSite(static_cast<int>(i), to[i]);
+      }
+      else
+      {
+         triangulation.moveSites(ids.data(), to.data(), to.size());
+      }
+      triangulation.getMesh(mesh, meshScratch);
+      Voronoi::getDiagram(mesh, bounds, diagram, workspace);
+      Voronoi::getCentroids(diagram, centroids, areas);
+      benchmark::DoNotOptimize(centroids.data());
+      forward = !forward;
+   }
+
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Site counts 10 ... 100k crossed with every distribution
+static void sizesAndDistributions(benchmark::internal::Benchmark *bench)
+{
+   bench->ArgNames({"sites", "dist"});
+   for (int64_t sites = 10; sites <= 100000; sites *= 10)
+   {
+      for (int d = 0; d <= static_cast<int>(Distribution::NearCollinear); ++d)
+         bench->Args({sites, d});
+   }
+   bench->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK(BM_Triangulate)->Apply(sizesAndDistributions);
+BENCHMARK(BM_TriangulateThreads)
+   ->ArgNames({"sites", "threads"})
+   ->ArgsProduct({{100000, 1000000}, {1, 2, 4, 8}})
+   ->Unit(benchmark::kMillisecond)
+   ->UseRealTime();
+BENCHMARK(BM_GetDiagram)->Apply(sizesAndDistributions);
+BENCHMARK(BM_GetDiagramThreads)
+   ->ArgNames({"sites", "threads"})
+   ->ArgsProduct({{100000, 1000000}, {1, 2, 4, 8}})
+   ->Unit(benchmark::kMillisecond)
+   ->UseRealTime();
+BENCHMARK(BM_Rebuild)
+   ->ArgNames({"sites", "threads"})
+   ->ArgsProduct({{1000, 100000, 1000000}, {1, 4}})
+   ->Unit(benchmark::kMillisecond)
+   ->UseRealTime();
+BENCHMARK(BM_GetCells)->Apply(sizesAndDistributions);
+BENCHMARK(BM_GetEdges)->Apply(sizesAndDistributions);
+BENCHMARK(BM_ClipPolygon)->Apply(sizesAndDistributions);
+BENCHMARK(BM_ClipPolygons)->Apply(sizesAndDistributions);
+BENCHMARK(BM_ClipEdge)->Apply(sizesAndDistributions);
+BENCHMARK(BM_ClipEdges)->Apply(sizesAndDistributions);
+BENCHMARK(BM_RelaxStep)
+   ->ArgNames({"sites", "mode"})
+   ->ArgsProduct({{1000, 5000}, {0, 1, 2}})
+   ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_BallPhysics)
+   ->ArgNames({"sites", "balls"})
+   ->ArgsProduct({{100, 1000, 10000}, {100, 500}})
+   ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FindCell)
+   ->ArgNames({"sites", "dist", "coherent"})
+   ->ArgsProduct({{1000, 100000, 1000000}, {0, 1}, {0, 1}})
+   ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
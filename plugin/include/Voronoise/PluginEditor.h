@@ -1,12 +1,12 @@
 #pragma once
 
 #include "PluginProcessor.h"
-#include "geometry/Utils.h"
-#include <JuceHeader.h> 
-#include <vector>
+#include "geometry/GeometryWorker.h"
+#include <JuceHeader.h>
 
 //==============================================================================
-class VoronoiseAudioProcessorEditor final : public juce::AudioProcessorEditor
+class VoronoiseAudioProcessorEditor final : public juce::AudioProcessorEditor,
+                                            private juce::Timer
 {
 public:
     explicit VoronoiseAudioProcessorEditor (VoronoiseAudioProcessor&);
@@ -17,11 +17,31 @@ public:
     void resized() override;
 
     void mouseDoubleClick (const juce::MouseEvent& event) override;
+    void mouseDown (const juce::MouseEvent& event) override;
+    void mouseDrag (const juce::MouseEvent& event) override;
+    void mouseUp (const juce::MouseEvent& event) override;
+    bool keyPressed (const juce::KeyPress& key) override;
 
 private:
+    //==============================================================================
+    // Picks up the newest snapshot from the geometry worker and repaints if there was one
+    void timerCallback() override;
+
+    // Moves every site part of the way towards the centroid of its cell in the current snapshot
+    void relaxSites();
+
+    int findSiteAt (juce::Point<float> position) const;
+    juce::ValueTree getSitesTree() const { return valueTree.getChildWithName ("Sites"); }
+
     VoronoiseAudioProcessor& processorRef;
-    std::vector<GeoUtils::Point> points; 
     juce::ValueTree valueTree;
+    GeometrySnapshot::Ptr snapshot;
+    int draggedSite = -1;
+    mutable int lastCell = -1; // where the last hit test ended, to start the next one from
+
+    bool relaxing = false; // toggled with 'r'
+    std::vector<GeoUtils::Point> centroids;
+    std::vector<double> cellAreas;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VoronoiseAudioProcessorEditor)
 };
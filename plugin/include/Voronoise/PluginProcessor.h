@@ -2,10 +2,16 @@
 
 #include <JuceHeader.h>
 #include "synth/WavetableSynth.h"
+#include "synth/ModMatrix.h"
+#include "synth/WavetableGenerator.h"
 #include "DSP/Fifo.h"
+#include "geometry/GeometryWorker.h"
+#include "primitives/BallPhysics.h"
 
 //==============================================================================
-class VoronoiseAudioProcessor final : public juce::AudioProcessor
+class VoronoiseAudioProcessor final : public juce::AudioProcessor,
+                                      private juce::ValueTree::Listener,
+                                      private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -20,6 +26,14 @@ public:
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
 
     juce::ValueTree getValueTree();
+    GeometryWorker& getGeometryWorker() { return geometryWorker; }
+    // Cells are clipped to these bounds; the editor keeps them in step with its size
+    void setDiagramBounds (const GeoUtils::BBox& bounds);
+    // Message thread; the ball joins the simulation at the start of the next block. Returns
+    // false if too many launches are already waiting.
+    bool launchBall (const Ball& ball) { return ballLaunches.push (ball); }
+    // Message thread; the synth's "Cell" waveform becomes this cell's shape once it is built
+    void requestCellWavetable (std::vector<GeoUtils::Point> polygon, const GeoUtils::Point& site);
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
     using AudioProcessor::processBlock;
 
@@ -75,6 +89,34 @@ private:
 
     DSP_Order dspOrder;
 
+    void valueTreeChildAdded (juce::ValueTree& parent, juce::ValueTree& child) override;
+    void valueTreeChildRemoved (juce::ValueTree& parent, juce::ValueTree& child, int index) override;
+    void valueTreePropertyChanged (juce::ValueTree& tree, const juce::Identifier& property) override;
+    void valueTreeChildOrderChanged (juce::ValueTree& parent, int oldIndex, int newIndex) override;
+    void valueTreeRedirected (juce::ValueTree& tree) override;
+
+    // Sends the current sites to the geometry worker; coalesces every edit made since the last call
+    void handleAsyncUpdate() override;
+
+    // Message thread; siteKeys[i] stays with the i-th "Sites" child as others come and go
+    std::vector<int> siteKeys;
+    int nextSiteKey = 0;
+    void resetSiteKeys();
+
+    GeometryWorker geometryWorker;
+    GeoUtils::BBox diagramBounds { 0.0, 0.0, 400.0, 300.0 };
+    GeometrySnapshot::Ptr geometry; // audio thread's view of the diagram
+
+    static constexpr int maxBalls = 256;
+    SimpleMBComp::Fifo<Ball, 64> ballLaunches;
+    BallPhysics balls;
+    std::vector<BallNote> ballNotes; // capacity reserved in prepareToPlay
+
+    // Fed the features of the cell each ball plays from; read once per block
+    ModMatrix modMatrix;
+    float lastGain = 1.f;
+    void applyModulation (juce::AudioBuffer<float>& buffer);
+
     template<typename DSP>
     struct DSP_Choice : juce::dsp::ProcessorBase {
         void prepare(const juce::dsp::ProcessSpec& spec) override {
@@ -93,6 +135,14 @@ private:
     };
 
     WavetableSynth synth;
+    std::atomic<float>* waveform = nullptr; // index of a WavetableBank::Shape, or NUM_SHAPES for the cell
+    std::atomic<float>* attack = nullptr;
+    std::atomic<float>* decay = nullptr;
+    std::atomic<float>* sustain = nullptr;
+    std::atomic<float>* release = nullptr;
+    std::atomic<float>* cutoff = nullptr;
+    std::atomic<float>* resonance = nullptr;
+    WavetableGenerator wavetableGenerator;
     DSP_Choice<juce::dsp::Phaser<float>> phaser;
     DSP_Choice<juce::dsp::Reverb> reverb;
     DSP_Choice<juce::dsp::LadderFilter<float>> filter;
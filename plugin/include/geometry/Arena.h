@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace GeoUtils
+{
+   // Bump allocator for the temporaries of one rebuild, handed to containers as a
+   // std::pmr::memory_resource. Deallocation is a no-op and reset() frees everything at once.
+   //
+   // Whatever does not fit in the arena's block is taken from the heap, and the next reset()
+   // grows the block by that much. Once a rebuild of some size has run, later rebuilds up to
+   // that size do not touch the global heap.
+   //
+   // Not thread safe; every thread that allocates needs an arena of its own.
+   class Arena
+   {
+   public:
+      explicit Arena(size_t initialBytes = 0);
+
+      Arena(const Arena &) = delete;
+      Arena &operator=(const Arena &) = delete;
+
+      std::pmr::memory_resource *resource() { return &*bump; }
+
+      // Frees everything allocated from the arena since the last reset
+      void reset();
+
+      size_t capacity() const { return blockSize; }
+
+   private:
+      // Passes allocations through to the heap, counting the bytes
+      class Overflow : public std::pmr::memory_resource
+      {
+      public:
+         size_t bytes = 0;
+
+      private:
+         void *do_allocate(size_t size, size_t alignment) override;
+         void do_deallocate(void *ptr, size_t size, size_t alignment) override;
+         bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+      };
+
+      void startBlock();
+
+      std::unique_ptr<std::byte[]> block;
+      size_t blockSize = 0;
+      Overflow overflow;
+      std::optional<std::pmr::monotonic_buffer_resource> bump;
+   };
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "geometry/Utils.h"
+#include "geometry/Mesh.h"
+#include "geometry/Voronoi.h"
+#include <array>
+#include <vector>
+
+namespace Voronoi
+{
+   // Measurements of every cell that can drive sound, one array per feature so a reader
+   // touches only the features it uses. Each value is scaled to 0..1: sizes by the largest
+   // cell's, counts by the largest count, and the distance to the centre of the bounds by
+   // half their diagonal. Built with each snapshot; reading it is a plain array lookup.
+   class CellFeatures
+   {
+   public:
+      enum Feature
+      {
+         Area,
+         Perimeter,
+         Neighbours,
+         CentreDistance,
+         Vertices,
+         NUM_FEATURES
+      };
+
+      // Rows follow cellSites: cell c of the diagram fills row cellSites[c], unless that is
+      // -1. Rows of sites without a cell stay 0. Reuses the storage of an earlier build.
+      void build(const GeoUtils::Mesh &mesh, const Diagram &diagram, const GeoUtils::BBox &bounds,
+                 const std::vector<int> &cellSites, size_t numRows);
+
+      size_t numRows() const { return values[0].size(); }
+      float get(Feature feature, size_t row) const { return values[feature][row]; }
+
+      // Every feature of one row, in Feature order
+      std::array<float, NUM_FEATURES> getRow(size_t row) const;
+
+   private:
+      std::array<std::vector<float>, NUM_FEATURES> values;
+      std::vector<int> neighbourCounts;
+   };
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "geometry/Utils.h"
+#include "geometry/Mesh.h"
+#include <vector>
+
+namespace Voronoi
+{
+   // Finds the Voronoi cell a point lies in, i.e. its nearest site. Built once per mesh;
+   // queries are const, take no locks and never allocate, so every thread holding a snapshot
+   // may use its locator.
+   //
+   // A query starts at the hint, or else at the site a coarse grid keeps for the point's
+   // bucket. From there it walks the Delaunay graph to ever closer neighbours. A Delaunay
+   // graph has no local minimum, so the walk ends at the nearest site. Queries that move a
+   // little at a time, passing back the last result as the hint, take one or two steps.
+   class CellLocator
+   {
+   public:
+      // Reuses the storage of an earlier build
+      void build(const GeoUtils::Mesh &mesh);
+
+      // Cell (site index of the mesh) nearest to p, or -1 without sites. hint is a cell from
+      // an earlier query, or -1. Without triangles every point of the mesh is a candidate,
+      // including any that carry no live site.
+      int findCell(const GeoUtils::Point &p, int hint = -1) const;
+
+   private:
+      int walk(const GeoUtils::Point &p, int start) const;
+      int bucketOf(const GeoUtils::Point &p) const;
+      bool inMesh(int site) const { return neighbourOffsets[site] != neighbourOffsets[site + 1]; }
+
+      std::vector<GeoUtils::Point> points;
+
+      // Delaunay neighbours of site i are neighbours[neighbourOffsets[i]] up to
+      // neighbours[neighbourOffsets[i + 1] - 1]; sites outside the mesh have none
+      std::vector<int> neighbourOffsets;
+      std::vector<int> neighbours;
+
+      // Start site of each grid bucket, row by row: the site nearest the bucket's centre, found
+      // among its own sites and those its neighbours start from
+      std::vector<int> bucketSites;
+      double originX = 0.0, originY = 0.0, bucketScale = 0.0;
+      int columns = 0, rows = 0;
+   };
+}
@@ -1,10 +1,14 @@
 #pragma once
 #include "geometry/Utils.h"
+#include "geometry/Mesh.h"
+#include "geometry/TaskPool.h"
 #include <vector>
 
 namespace Delaunay
 {
-    std::vector<GeoUtils::Triangle> triangulate(const std::vector<GeoUtils::Point> &points);
+    // Large site sets are split across the pool's threads; the result does not depend on the pool
+    GeoUtils::Mesh triangulateMesh(const std::vector<GeoUtils::Point> &points, GeoUtils::TaskPool *pool = nullptr);
+    std::vector<GeoUtils::Triangle> triangulate(const std::vector<GeoUtils::Point> &points, GeoUtils::TaskPool *pool = nullptr);
 
     GeoUtils::Circumcircle getCircumcircle(const GeoUtils::Triangle &t);
 }
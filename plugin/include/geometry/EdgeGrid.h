@@ -0,0 +1,72 @@
+#pragma once
+#include "geometry/Utils.h"
+#include <algorithm>
+#include <vector>
+
+namespace GeoUtils
+{
+   // Uniform grid over line segments, for broad-phase collision tests. Each bucket keeps a copy
+   // of every edge whose bounding box overlaps it, so a query reads its candidates from a few
+   // contiguous runs. Built once per diagram; queries are const, take no locks and never
+   // allocate, so the audio thread may use the grid of a published snapshot.
+   class EdgeGrid
+   {
+   public:
+      // Reuses the storage of an earlier build. Edges reaching outside bounds are filed in the
+      // border buckets.
+      void build(const std::vector<Edge> &edges, const BBox &bounds);
+
+      // Calls visit(edge) once for every edge filed in a bucket that box overlaps
+      template <typename Visit>
+      void forEachEdgeNear(const BBox &box, Visit &&visit) const
+      {
+         if (columns == 0)
+            return;
+
+         const int firstColumn = columnOf(box.minX), lastColumn = columnOf(box.maxX);
+         const int firstRow = rowOf(box.minY), lastRow = rowOf(box.maxY);
+         for (int row = firstRow; row <= lastRow; ++row)
+         {
+            for (int column = firstColumn; column <= lastColumn; ++column)
+            {
+               const int bucket = row * columns + column;
+               for (int k = bucketOffsets[bucket]; k < bucketOffsets[bucket + 1]; ++k)
+               {
+                  // An edge filed in several of the visited buckets is only taken from the
+                  // first of them
+                  const Entry &entry = entries[k];
+                  if (std::max(entry.firstColumn, firstColumn) == column && std::max(entry.firstRow, firstRow) == row)
+                     visit(entry.edge);
+               }
+            }
+         }
+      }
+
+      size_t numEdges() const { return numSourceEdges; }
+
+   private:
+      struct Entry
+      {
+         Edge edge;
+         int firstColumn, firstRow; // of the buckets the edge is filed in
+      };
+
+      int columnOf(double x) const
+      {
+         return static_cast<int>(std::clamp((x - originX) * bucketScale, 0.0, static_cast<double>(columns - 1)));
+      }
+      int rowOf(double y) const
+      {
+         return static_cast<int>(std::clamp((y - originY) * bucketScale, 0.0, static_cast<double>(rows - 1)));
+      }
+
+      // Edges of bucket b, row by row, are entries[bucketOffsets[b]] up to
+      // entries[bucketOffsets[b + 1] - 1]
+      std::vector<int> bucketOffsets;
+      std::vector<Entry> entries;
+      size_t numSourceEdges = 0;
+
+      double originX = 0.0, originY = 0.0, bucketScale = 0.0;
+      int columns = 0, rows = 0;
+   };
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "geometry/Utils.h"
+#include "geometry/Mesh.h"
+#include "geometry/TaskPool.h"
+#include "geometry/Triangulation.h"
+#include "geometry/Voronoi.h"
+#include "geometry/CellLocator.h"
+#include "geometry/EdgeGrid.h"
+#include "geometry/CellFeatures.h"
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+// Immutable result of one geometry rebuild. Readers only ever see complete snapshots.
+struct GeometrySnapshot : juce::ReferenceCountedObject
+{
+   using Ptr = juce::ReferenceCountedObjectPtr<GeometrySnapshot>;
+
+   uint64_t version = 0;
+   GeoUtils::BBox bounds{};
+   std::vector<GeoUtils::Point> sites; // in "Sites" tree order
+   GeoUtils::Mesh mesh;
+   Voronoi::Diagram diagram;
+   Voronoi::CellLocator locator; // finds cells of the mesh, i.e. triangulation site ids
+   std::vector<int> cellSites;   // index in sites of each cell's site, or -1 for unused ids
+   GeoUtils::EdgeGrid edgeGrid;  // edges between cells and the sides of bounds, for collisions
+   Voronoi::CellFeatures features; // one row per site, in the order of sites
+
+   juce::Path sitesPath;
+   juce::Path cellsPath;
+   juce::Path trianglesPath;
+};
+
+// Triangulates and builds Voronoi cells on a background thread.
+//
+// Requests are coalesced: a request replaces any the worker has not started on yet, so a
+// burst of edits costs one rebuild. Finished snapshots are handed to the editor and to the
+// audio thread through one atomic mailbox each; readers never block and never free a
+// snapshot, that happens on the message thread once nobody holds it any more.
+class GeometryWorker : private juce::Thread,
+                       private juce::Timer
+{
+public:
+   GeometryWorker();
+   ~GeometryWorker() override;
+
+   // Message thread only. keys[i] names sites[i] for as long as it exists, so the worker can
+   // tell a removed or inserted site from every later one shifting along.
+   void requestRebuild(std::vector<GeoUtils::Point> sites, std::vector<int> keys, const GeoUtils::BBox &bounds);
+
+   // Swaps in the newest snapshot if there is one; each must only be called from its own thread
+   bool pullForEditor(GeometrySnapshot::Ptr &latest) { return pull(editorMailbox, latest); }
+   bool pullForAudio(GeometrySnapshot::Ptr &latest) { return pull(audioMailbox, latest); }
+
+private:
+   struct Request
+   {
+      std::vector<GeoUtils::Point> sites;
+      std::vector<int> keys;
+      GeoUtils::BBox bounds;
+   };
+
+   struct TrackedSite
+   {
+      int id; // in the triangulation
+      GeoUtils::Point position;
+      uint64_t seen; // version of the last request that had it
+   };
+
+   void run() override;
+   void timerCallback() override;
+
+   GeometrySnapshot::Ptr build(const Request &request);
+   GeometrySnapshot::Ptr takeSpareSnapshot();
+   void publish(const GeometrySnapshot::Ptr &snapshot);
+   static void post(std::atomic<GeometrySnapshot *> &mailbox, GeometrySnapshot *snapshot);
+   static bool pull(std::atomic<GeometrySnapshot *> &mailbox, GeometrySnapshot::Ptr &latest);
+
+   std::atomic<Request *> pending{nullptr};
+   std::atomic<GeometrySnapshot *> editorMailbox{nullptr};
+   std::atomic<GeometrySnapshot *> audioMailbox{nullptr};
+
+   // Worker thread state; siteIds[i] is the triangulation id of the i-th requested site
+   juce::SharedResourcePointer<GeoUtils::TaskPool> taskPool;
+   Delaunay::Triangulation triangulation;
+   Voronoi::Workspace voronoiWorkspace;
+   GeoUtils::Arena meshScratch;
+   std::unordered_map<int, TrackedSite> currentSites; // by key
+   std::vector<int> siteIds;
+   std::vector<int> movedIds;
+   std::vector<GeoUtils::Point> movedTargets;
+   std::vector<GeoUtils::Edge> edges;
+   uint64_t version = 0;
+
+   // Keeps every published snapshot alive until only the pool references it. The newest such
+   // snapshot is kept as a spare and rebuilt in place, so steady editing stays off the heap.
+   juce::CriticalSection releaseLock;
+   std::vector<GeometrySnapshot::Ptr> releasePool;
+
+   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GeometryWorker)
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include "geometry/Utils.h"
+#include <vector>
+
+namespace GeoUtils
+{
+   constexpr int NO_HALFEDGE = -1;
+
+   inline int nextHalfedge(int e) { return (e % 3 == 2) ? e - 2 : e + 1; }
+   inline int prevHalfedge(int e) { return (e % 3 == 0) ? e + 2 : e - 1; }
+
+   // Triangle mesh in half-edge form. Triangle t owns half-edges 3t, 3t+1 and 3t+2 in
+   // counter-clockwise order; half-edge e starts at points[triangles[e]] and ends where
+   // nextHalfedge(e) starts. halfedges[e] is the opposite half-edge in the neighbouring
+   // triangle, or NO_HALFEDGE on the convex hull.
+   struct Mesh
+   {
+      std::vector<Point> points;
+      std::vector<int> triangles;
+      std::vector<int> halfedges;
+      std::vector<Point> circumcenters; // one per triangle, or empty if the producer did not compute them
+
+      size_t numTriangles() const { return triangles.size() / 3; }
+
+      Triangle getTriangle(size_t t) const
+      {
+         return {points[triangles[3 * t]], points[triangles[3 * t + 1]], points[triangles[3 * t + 2]]};
+      }
+
+      std::vector<Triangle> toTriangles() const;
+
+      // Rebuilds connectivity from loose triangles, merging vertices that compare equal
+      static Mesh fromTriangles(const std::vector<Triangle> &tris);
+   };
+}
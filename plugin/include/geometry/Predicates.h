@@ -0,0 +1,17 @@
+#pragma once
+#include "geometry/Utils.h"
+
+namespace GeoUtils
+{
+   // Robust orientation and incircle tests after Shewchuk, "Adaptive Precision Floating-Point
+   // Arithmetic and Fast Robust Geometric Predicates". The plain floating-point determinant is
+   // returned whenever its error bound proves the sign; only the rare near-degenerate query
+   // falls back to exact expansion arithmetic. The sign is always correct, the magnitude is
+   // only an approximation.
+
+   // > 0 if c lies to the left of a->b, 0 if the three points are collinear
+   double orient2d(const Point &a, const Point &b, const Point &c);
+
+   // > 0 if d lies inside the circumcircle of the counter-clockwise triangle abc, 0 if on it
+   double incircle(const Point &a, const Point &b, const Point &c, const Point &d);
+}
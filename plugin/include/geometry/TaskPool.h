@@ -0,0 +1,81 @@
+#pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace GeoUtils
+{
+   // Non-owning reference to a callable taking a task index. Unlike std::function it never
+   // allocates; the callable has to outlive the parallelFor it is passed to.
+   class TaskRef
+   {
+   public:
+      template <typename Task>
+         requires(!std::is_same_v<std::remove_cvref_t<Task>, TaskRef>)
+      TaskRef(Task &&task) : object(const_cast<void *>(static_cast<const void *>(&task))),
+                             invoke([](void *callable, int index)
+                                    { (*static_cast<std::remove_reference_t<Task> *>(callable))(index); })
+      {
+      }
+
+      void operator()(int index) const { invoke(object, index); }
+
+   private:
+      void *object;
+      void (*invoke)(void *, int);
+   };
+
+   // Fixed set of threads that split index ranges between them. Every thread starts on an
+   // equal share of the indices; one that runs dry steals the upper half of the largest share
+   // left, so uneven tasks still keep all cores busy.
+   //
+   // Callers must not make their results depend on which thread ran a task or in what order:
+   // the geometry built on this has to come out the same for any number of threads.
+   class TaskPool
+   {
+   public:
+      // numThreads counts the calling thread. 0 uses one fewer than the hardware threads, at
+      // least one: in a plugin the audio and message threads need a core too, and a pool as
+      // wide as the machine would stall them during large rebuilds.
+      explicit TaskPool(int numThreads = 0);
+      ~TaskPool();
+
+      TaskPool(const TaskPool &) = delete;
+      TaskPool &operator=(const TaskPool &) = delete;
+
+      int getNumThreads() const { return static_cast<int>(workers.size()) + 1; }
+
+      // Runs task(i) for every i in [0, count) and returns once all have finished. The calling
+      // thread takes part. Calls from inside a task run serially on that thread.
+      void parallelFor(int count, TaskRef task);
+
+   private:
+      struct Share
+      {
+         std::mutex lock;
+         int next = 0, end = 0;
+      };
+
+      void workerLoop(int index);
+      void runShare(int index);
+      bool take(int index, int &task);
+
+      std::vector<std::thread> workers;
+      std::unique_ptr<Share[]> shares;
+
+      std::mutex jobLock; // one parallelFor at a time
+      std::mutex stateLock;
+      std::condition_variable wake;
+      std::condition_variable finished;
+      const TaskRef *job = nullptr;
+      unsigned generation = 0;
+      int busyWorkers = 0;
+      bool quitting = false;
+   };
+
+   // pool->parallelFor(count, task), or every task in order on this thread without a pool
+   void parallelFor(TaskPool *pool, int count, TaskRef task);
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include "geometry/Utils.h"
+#include "geometry/Mesh.h"
+#include "geometry/TaskPool.h"
+#include "geometry/Arena.h"
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <cstdint>
+
+namespace Delaunay
+{
+   // Delaunay triangulation that is kept up to date as sites are inserted, moved and removed.
+   // Every edit only repairs the triangles around the affected site, and afterwards
+   // getChangedSites() lists the sites whose Voronoi cells are different.
+   //
+   // Site ids are stable for the lifetime of a site; ids of removed sites are reused.
+   // Sites that coincide with another site, or that cannot be triangulated yet because all
+   // sites are collinear, stay registered and join the mesh once they can.
+   //
+   // Large builds split the sites into vertical slabs by x, triangulate each slab on its own
+   // (on the threads of a TaskPool when one is given) and stitch neighbouring slabs together.
+   // The slabs depend only on the sites, so the mesh is the same for any number of threads.
+   class Triangulation
+   {
+   public:
+      Triangulation() = default;
+      explicit Triangulation(const std::vector<GeoUtils::Point> &points, GeoUtils::TaskPool *pool = nullptr);
+
+      // Replaces all sites; site ids are the indices into points
+      void build(const std::vector<GeoUtils::Point> &points, GeoUtils::TaskPool *pool = nullptr);
+      void clear();
+
+      int insertSite(const GeoUtils::Point &p);
+      bool removeSite(int site);
+      bool moveSite(int site, const GeoUtils::Point &p);
+
+      // Moves sites[i] to targets[i] for each i, as in one step of a relaxation. Sites whose
+      // triangles stay the right way round keep their connectivity and are repaired together by
+      // edge flips; the rest are moved one at a time, as by moveSite.
+      void moveSites(const int *sites, const GeoUtils::Point *targets, size_t count);
+
+      const std::vector<int> &getChangedSites() const { return changedSites; }
+
+      bool isSite(int site) const { return site >= 0 && site < static_cast<int>(positions.size()) && live[site]; }
+      const GeoUtils::Point &getSite(int site) const { return positions[site]; }
+      size_t getNumSites() const { return numLive; }
+
+      // Finite triangles only; points are indexed by site id
+      GeoUtils::Mesh getMesh() const;
+
+      // The same, written over mesh so its storage is reused
+      void getMesh(GeoUtils::Mesh &mesh) const;
+
+      // The same again, with temporaries taken from arena, which is reset first. Any number of
+      // threads may read the triangulation at once as long as each passes its own arena.
+      void getMesh(GeoUtils::Mesh &mesh, GeoUtils::Arena &arena) const;
+
+   private:
+      static constexpr int GHOST = -1;
+      static constexpr int NONE = -1;
+
+      struct BoundaryEdge
+      {
+         int from, to, twin;
+      };
+
+      std::vector<GeoUtils::Point> positions;
+      std::vector<uint8_t> live;
+      std::vector<int> vertexEdges; // a half-edge leaving each site, NONE if the site is not in the mesh
+      std::vector<int> freeSites;
+      std::vector<int> hiddenSites;
+      size_t numLive = 0;
+
+      std::vector<int> triangles; // start vertex of each half-edge, three per triangle
+      std::vector<int> halfedges; // twin of each half-edge, NONE for unused triangle slots
+      std::vector<int> freeTriangles;
+
+      // Circumcircle of each triangle slot with a bound on its rounding error, kept as separate
+      // arrays so the batch in-circle kernel can stream them. Ghost and badly conditioned
+      // triangles carry an infinite error and always go to the exact predicate.
+      std::vector<double> circumX;
+      std::vector<double> circumY;
+      std::vector<double> circumR2;
+      std::vector<double> circumErr;  // scales the distance from the centre to the query point
+      std::vector<double> circumErrR; // constant part of the bound
+      size_t numFinite = 0;
+      int lastTriangle = NONE;
+      bool splitLargeBuilds = true; // off for the slabs of a split build
+
+      std::vector<int> changedSites;
+      std::vector<uint32_t> siteStamps;
+      std::vector<uint32_t> triangleStamps;
+      uint32_t editEpoch = 0;
+      uint32_t searchEpoch = 0;
+
+      std::vector<int> cavity;
+      std::vector<BoundaryEdge> boundary;
+      std::vector<int> candidateEdges;
+      std::vector<int> candidateTriangles;
+      std::vector<int8_t> candidateSides;
+      std::vector<std::pair<int, int>> spokes;
+      std::vector<int> ring;
+      std::vector<int> ringTwins;
+      std::vector<int> flips;
+
+      // Bookkeeping of one moveSites batch
+      std::vector<int> moveSlots;
+      std::vector<GeoUtils::Point> moveOrigins;
+      std::vector<int> moveTriangles;
+      std::vector<int> heldBackMoves;
+      std::vector<int> movedSites;
+
+      // Temporaries of one edit or rebuild, and the slabs of the last split build; both keep
+      // their storage so repeated builds stay off the heap
+      GeoUtils::Arena scratch;
+      std::vector<std::unique_ptr<Triangulation>> slabs;
+
+      bool isLiveTriangle(int t) const { return halfedges[3 * t] != NONE; }
+      bool isGhost(int t) const;
+
+      int allocateSite(const GeoUtils::Point &p);
+      int addTriangle(int a, int b, int c);
+      void setTriangle(int t, int a, int b, int c);
+      void updateCircumcircle(int t);
+      void freeTriangle(int t);
+      void link(int e, int twin);
+      void beginEdit();
+      void markChanged(int site);
+
+      void clearMesh();
+      void buildAll(GeoUtils::TaskPool *pool);
+      void rebuild(GeoUtils::TaskPool *pool = nullptr);
+      bool buildSlabs(const std::pmr::vector<int> &ids, GeoUtils::TaskPool *pool);
+      bool stitch(int leftMax, int rightMin);
+      int hullGhost(int v) const;
+      void seed(int a, int b, int c);
+      bool inCircumcircle(int t, const GeoUtils::Point &p) const;
+      bool conflicts(int t, const GeoUtils::Point &p) const;
+      int startTriangle();
+      int locate(const GeoUtils::Point &p);
+      int findConflict(const GeoUtils::Point &p);
+
+      bool insertVertex(int v);
+      bool unlinkVertex(int v);
+      void restoreHidden(const GeoUtils::Point &p);
+      void collectStar(int v);
+      int clipEar(int prev, int curr, int next);
+      void flip(int e);
+      void legalize();
+      bool tryRelocate(int v, const GeoUtils::Point &p);
+   };
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <juce_graphics/juce_graphics.h>
+#include <memory_resource>
 #include <vector>
 #include <cmath> // Required for std::abs
 
@@ -75,6 +76,33 @@ namespace GeoUtils
       }
    };
 
+   // Working storage for the polygon clipper. Kept between calls it stops allocating once it
+   // has grown to fit the largest polygon seen.
+   struct ClipScratch
+   {
+      explicit ClipScratch(std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+          : first(resource), second(resource)
+      {
+      }
+
+      std::pmr::vector<Point> first;
+      std::pmr::vector<Point> second;
+   };
+
    bool clipEdge(Edge &edge, const BBox &box);
    std::vector<Point> clipPolygon(const std::vector<Point> &poly, const BBox &box);
+
+   // Appends poly clipped to box onto out and returns the number of points added. poly must
+   // not point into out.
+   size_t clipPolygon(const Point *poly, size_t count, const BBox &box, std::pmr::vector<Point> &out, ClipScratch &scratch);
+
+   // Clips a flat list of polygons, polygon i being vertices[offsets[i]] up to
+   // vertices[offsets[i + 1] - 1]. The results replace the contents of outVertices and
+   // outOffsets in the same layout; a polygon that misses the box comes out empty.
+   void clipPolygons(const std::vector<Point> &vertices, const std::vector<int> &offsets, const BBox &box,
+                     std::pmr::vector<Point> &outVertices, std::pmr::vector<int> &outOffsets, ClipScratch &scratch);
+
+   // Clips every edge to box in place and moves the ones that touch it to the front, keeping
+   // their order; returns how many there are
+   size_t clipEdges(Edge *edges, size_t count, const BBox &box);
 }
@@ -1,6 +1,10 @@
 #pragma once
 #include "geometry/Utils.h"
 #include "geometry/Delaunay.h"
+#include "geometry/Mesh.h"
+#include "geometry/TaskPool.h"
+#include "geometry/Arena.h"
+#include <deque>
 #include <vector>
 #include <map>
 
@@ -11,6 +15,22 @@ namespace Voronoi
       std::vector<GeoUtils::Point> vertices;
    };
 
+   // Voronoi diagram in flat arrays. Cell i belongs to sites[i] (site i of the mesh) and is
+   // the counter-clockwise polygon through vertices[cellVertices[cellOffsets[i]]] up to
+   // vertices[cellVertices[cellOffsets[i + 1] - 1]]. Unclipped Voronoi vertices are shared
+   // between the cells that meet there; sites without a cell have an empty range.
+   struct Diagram
+   {
+      std::vector<GeoUtils::Point> sites;
+      std::vector<GeoUtils::Point> vertices;
+      std::vector<int> cellOffsets;
+      std::vector<int> cellVertices;
+
+      size_t numCells() const { return sites.size(); }
+      int cellSize(size_t cell) const { return cellOffsets[cell + 1] - cellOffsets[cell]; }
+      const GeoUtils::Point &cellVertex(size_t cell, int k) const { return vertices[cellVertices[cellOffsets[cell] + k]]; }
+   };
+
    struct EdgeComparator
    {
       bool operator()(const GeoUtils::Edge &a, const GeoUtils::Edge &b) const
@@ -34,6 +54,38 @@ namespace Voronoi
       }
    };
 
+   // Working memory of getDiagram: an arena for its own temporaries and one for each run of
+   // sites, since runs are built on different threads. Kept between rebuilds, the arenas grow
+   // to fit the largest rebuild so far.
+   struct Workspace
+   {
+      GeoUtils::Arena shared;
+      std::deque<GeoUtils::Arena> runs;
+   };
+
+   // Cells are built in runs of sites spread over the pool's threads; the result does not
+   // depend on the pool
+   Diagram getDiagram(const GeoUtils::Mesh &mesh, const GeoUtils::BBox &bbox, GeoUtils::TaskPool *pool = nullptr);
+
+   // The same, written over diagram. With the diagram and workspace of an earlier rebuild at
+   // least as large, this makes no heap allocations.
+   void getDiagram(const GeoUtils::Mesh &mesh, const GeoUtils::BBox &bbox, Diagram &diagram, Workspace &workspace,
+                   GeoUtils::TaskPool *pool = nullptr);
+
+   std::vector<GeoUtils::Edge> getEdges(const GeoUtils::Mesh &mesh, const GeoUtils::BBox &bbox);
+
+   // The same, written over edges with temporaries from scratch; makes no heap allocations
+   // once edges and scratch have served a mesh at least as large
+   void getEdges(const GeoUtils::Mesh &mesh, const GeoUtils::BBox &bbox, std::vector<GeoUtils::Edge> &edges, GeoUtils::Arena &scratch);
+
+   // Area and centroid of every cell of the diagram, over its flat arrays in one pass. Sites
+   // without a cell get area 0 and their own position as centroid.
+   void getCentroids(const Diagram &diagram, std::vector<GeoUtils::Point> &centroids, std::vector<double> &areas);
+
+   // Cells keyed by site position, built from getDiagram
+   std::map<GeoUtils::Point, Cell, GeoUtils::PointComparator> getCells(const GeoUtils::Mesh &mesh, const GeoUtils::BBox &bbox, GeoUtils::TaskPool *pool = nullptr);
+
+   // Loose-triangle overloads, connectivity is rebuilt with GeoUtils::Mesh::fromTriangles
    std::vector<GeoUtils::Edge> getEdges(const std::vector<GeoUtils::Triangle> &tris, const GeoUtils::BBox &bbox);
    std::map<GeoUtils::Point, Cell, GeoUtils::PointComparator> getCells(const std::vector<GeoUtils::Triangle> &tris, const GeoUtils::BBox &bbox);
 }
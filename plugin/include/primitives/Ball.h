@@ -1,17 +1,20 @@
 #pragma once
 
-#include <JuceHeader.h>
+#include <juce_graphics/juce_graphics.h>
 
-class Ball : juce::Point {
-
-private:
+// A ball as it is launched; BallPhysics moves it from there
+struct Ball
+{
+   juce::Point<double> position;
    juce::Colour color;
 
-   float radius;
-   float angle;
-   float velocity;
+   float radius = 4.f;
+   float angle = 0.f;      // direction of travel, in radians from the x axis towards the y axis
+   float velocity = 200.f; // in diagram units per second
+
+   float frequency = 440.f; // frequency of its associated note
 
-   float frequency; // frequency of its associated note
+   float timeLeftAlive = 10.f; // in seconds
 
-   float timeLeftAlive;
-}
\ No newline at end of file
+   int site = -1; // index in the "Sites" tree of the cell it starts in, if known
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "primitives/Ball.h"
+#include "geometry/EdgeGrid.h"
+#include <vector>
+
+// A note started by an impact or, with velocity 0, ended; sample is the offset into the block
+// and site that of the ball that played it
+struct BallNote
+{
+   int sample;
+   int note;
+   float velocity;
+   int site;
+};
+
+// Moves balls in straight lines and bounces them off the edges of a GeoUtils::EdgeGrid. Every
+// bounce starts the ball's note at the sample it happened on, and ends it a little later.
+//
+// Balls are kept in flat arrays, one per property, sized in prepare(); launching, moving and
+// retiring balls never allocates, so all of it may run on the audio thread.
+class BallPhysics
+{
+public:
+   // Makes room for maxBalls; not on the audio thread
+   void prepare(double sampleRate, int maxBalls);
+
+   // Returns false, dropping the ball, when maxBalls are already moving
+   bool launch(const Ball &ball);
+
+   // Advances every ball by numSamples. Notes are appended to notes as long as its capacity
+   // allows, so reserve room for them beforehand.
+   void process(int numSamples, const GeoUtils::EdgeGrid &edges, std::vector<BallNote> &notes);
+
+   int getNumBalls() const { return static_cast<int>(x.size()); }
+   GeoUtils::Point getPosition(int ball) const { return {x[ball], y[ball]}; }
+
+private:
+   void retire(int ball);
+
+   double sampleRate = 44100.0;
+   size_t capacity = 0;
+
+   // Positions in diagram units, velocities in units per sample
+   std::vector<double> x, y, vx, vy;
+   std::vector<double> radius;
+   std::vector<int> note;
+   std::vector<int> site;
+   std::vector<int> samplesLeftAlive;
+   std::vector<int> samplesLeftSounding; // until the ball's note ends, or -1 once it has
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <JuceHeader.h>
+#include "geometry/CellFeatures.h"
+#include <array>
+
+// Routes cell features to synth parameters. Each destination is the sum of every
+// source scaled by its depth, clamped to -1..1 and smoothed over a few blocks so a jump from
+// one cell to the next does not click.
+//
+// Depths are plugin parameters, read through their atomics; sources and smoothing belong to
+// the audio thread, which only ever hands in a row of a CellFeatures table.
+class ModMatrix
+{
+public:
+   static constexpr int NUM_SOURCES = Voronoi::CellFeatures::NUM_FEATURES;
+
+   enum Destination
+   {
+      Gain,
+      FilterCutoff,    // of each voice, set once per note through evaluate()
+      FilterResonance, // likewise
+      NUM_DESTINATIONS
+   };
+
+   using Sources = std::array<float, NUM_SOURCES>;
+
+   // One depth parameter, -1..1, per source and destination
+   static void addParameters(juce::AudioProcessorValueTreeState::ParameterLayout& layout);
+   static juce::String getParameterID(int source, Destination destination);
+
+   // Message thread, once the parameters exist
+   void attach(juce::AudioProcessorValueTreeState& apvts);
+
+   // Audio thread
+   void prepareToPlay(double sampleRate);
+   void setSources(const Sources& newSources) { sources = newSources; }
+   void advance(int numSamples);
+   float getValue(Destination destination) const { return values[destination]; }
+   // What destination would be for sources, unsmoothed; for settings fixed per note
+   float evaluate(Destination destination, const Sources& rowSources) const;
+
+private:
+   std::array<std::atomic<float>*, NUM_SOURCES * NUM_DESTINATIONS> depths{};
+   Sources sources{};
+   std::array<juce::SmoothedValue<float>, NUM_DESTINATIONS> smoothed;
+   std::array<float, NUM_DESTINATIONS> values{};
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <JuceHeader.h>
+#include <cstdint>
+#include <vector>
+
+// ADSR levels and gliding pitch for every voice of a pool, one array per property.
+//
+// Levels move a short step at a time: the attack rises linearly, decay and release fall
+// exponentially, and each is evaluated in closed form for the step's length, so the
+// per-sample work is just the linear ramp between a voice's levels before and after. A voice
+// whose release has died away is Idle again and can be retired.
+class VoiceEnvelopes
+{
+public:
+   // Times in seconds; decay and release are the time to fall by 60 dB. sustain is a
+   // fraction of the note's velocity.
+   struct Settings
+   {
+      float attack = 0.005f;
+      float decay = 0.3f;
+      float sustain = 0.7f;
+      float release = 0.3f;
+
+      bool operator==(const Settings&) const = default;
+   };
+
+   enum Stage : uint8_t
+   {
+      Idle,
+      Attack,
+      Decay, // falls towards the sustain level and stays there
+      Release
+   };
+
+   // Not on the audio thread
+   void prepare(double sampleRate, int numVoices);
+
+   void setSettings(const Settings& newSettings);
+
+   // A voice still sounding starts its attack from where it is, so stealing it does not click
+   void noteOn(int voice, float velocity);
+   void noteOff(int voice);
+   // Without glide the pitch jumps straight to frequency
+   void setPitch(int voice, float frequency, bool glide);
+
+   // Moves the listed voices numSamples on. Keep steps short, a sub-block or so: within one
+   // the level is a straight line, which rounds off any corner between stages.
+   void advance(const int* voiceIds, size_t count, int numSamples);
+
+   Stage getStage(int voice) const { return stages[static_cast<size_t>(voice)]; }
+   float getStartLevel(int voice) const { return startLevels[static_cast<size_t>(voice)]; }
+   float getLevel(int voice) const { return levels[static_cast<size_t>(voice)]; }
+   float getFrequency(int voice) const { return frequencies[static_cast<size_t>(voice)]; }
+   bool isGliding(int voice) const { return frequencies[static_cast<size_t>(voice)] != targetFrequencies[static_cast<size_t>(voice)]; }
+
+private:
+   void updateCoefficients();
+
+   double sampleRate = 44100.0;
+   Settings settings;
+   float attackStep = 0.f; // level per sample
+   float decayCoefficient = 0.f, releaseCoefficient = 0.f, glideCoefficient = 0.f; // per sample
+
+   std::vector<Stage> stages;
+   std::vector<float> velocities;
+   std::vector<float> startLevels; // at the start of the last step
+   std::vector<float> levels;
+   std::vector<float> frequencies;
+   std::vector<float> targetFrequencies;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// A state-variable lowpass filter for every voice of a pool, run a register of voices at a
+// time: each lane of a juce::dsp::SIMDRegister carries one voice. Every group of voices is
+// stepped through each sample before the next, so the groups' independent recurrences overlap
+// and the voices are summed in registers.
+//
+// Cutoff and resonance are a shared base plus a per-voice offset, smoothed and turned into
+// coefficients once per sub-block of SUB_BLOCK samples rather than per sample. A voice's
+// state stays in plain per-voice arrays between sub-blocks, so any voices can share a group.
+class VoiceFilters
+{
+public:
+   using Lanes = juce::dsp::SIMDRegister<float>;
+   static constexpr int LANES = static_cast<int>(Lanes::SIMDNumElements);
+   static constexpr int SUB_BLOCK = 32;
+
+   // Not on the audio thread
+   void prepare(double sampleRate, int numVoices);
+
+   // cutoff in Hz, resonance 0..1
+   void setBase(float cutoff, float resonance);
+   // Offsets from the base, in octaves and resonance; the voice glides to them
+   void setModulation(int voice, float cutoffOctaves, float resonance);
+   // Clears the voice's state and jumps straight to its modulation, for a voice starting afresh
+   void reset(int voice);
+
+   // Once per sub-block, for every voice about to be processed
+   void updateCoefficients(const int* voiceIds, size_t count);
+
+   // SUB_BLOCK samples of input for the voice at slot in the list given to process(),
+   // silent until written
+   float* getInput(size_t slot) { return input + slot * SUB_BLOCK; }
+   // Filters the inputs of the count listed voices, adds them all to output and silences the
+   // inputs again
+   void process(const int* voiceIds, size_t count, int numSamples, float* output);
+
+private:
+   void updateCoefficients(size_t voice);
+
+   double sampleRate = 44100.0;
+   float baseCutoff = 20000.f, baseResonance = 0.f;
+   bool baseChanged = true;
+   float smoothing = 1.f; // fraction of the way to the target covered per sub-block
+
+   std::vector<float> octaves, targetOctaves;
+   std::vector<float> resonances, targetResonances;
+   std::vector<float> a1, a2, a3; // per voice, for the current sub-block
+   std::vector<float> ic1eq, ic2eq;
+
+   // Sized for every voice, rounded up to whole groups
+   size_t numGroups = 0;
+   juce::HeapBlock<float> storage;
+   float* input = nullptr;       // a row of SUB_BLOCK samples per slot
+   float* interleaved = nullptr; // SUB_BLOCK frames of every group's registers
+   float* laneState = nullptr;   // a1, a2, a3, ic1eq and ic2eq, a register per group each
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+
+// One cycle of a waveform, fixed once built, kept at one band-limited level per octave: level k
+// holds the harmonics up to getSize() / 2^(k + 1), so it can be played back skipping up to 2^k
+// samples of the table per output sample without aliasing. Every level starts on a 64-byte
+// boundary and is followed by a copy of its first sample, so interpolating past the last
+// sample needs no wrap.
+class Wavetable : public juce::ReferenceCountedObject
+{
+public:
+   using Ptr = juce::ReferenceCountedObjectPtr<Wavetable>;
+
+   // cycle's size has to be a power of two. Its DC offset is removed and every level scaled
+   // alike, so the loudest peaks at 1.
+   explicit Wavetable(const std::vector<float>& cycle);
+
+   int getSize() const { return size; }
+   int getNumLevels() const { return numLevels; }
+   const float* getSamples(int level = 0) const { return samples + static_cast<size_t>(level) * stride; }
+
+   // The level with the most harmonics that do not alias when read increment samples apart
+   int getLevelFor(float increment) const;
+
+private:
+   juce::HeapBlock<float> storage;
+   float* samples = nullptr;
+   int size = 0;
+   int numLevels = 0;
+   size_t stride = 0;
+
+   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Wavetable)
+};
+
+// Every waveform the synth can play, generated once and shared by all voices of all plugin
+// instances through juce::SharedResourcePointer<WavetableBank>. Tables are never changed, so
+// any thread may read them; all have TABLE_SIZE samples, so a voice may switch tables and keep
+// its phase.
+class WavetableBank
+{
+public:
+   static constexpr int TABLE_SIZE = 2048;
+
+   enum Shape
+   {
+      Sine,
+      Triangle,
+      Saw,
+      Square,
+      NUM_SHAPES
+   };
+
+   WavetableBank();
+
+   const Wavetable& get(Shape shape) const { return *tables[static_cast<size_t>(shape)]; }
+   Wavetable::Ptr getShared(Shape shape) const { return tables[static_cast<size_t>(shape)]; }
+
+   static juce::StringArray getShapeNames() { return {"Sine", "Triangle", "Saw", "Square"}; }
+
+private:
+   std::array<Wavetable::Ptr, NUM_SHAPES> tables;
+};
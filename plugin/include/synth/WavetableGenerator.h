@@ -0,0 +1,55 @@
+#pragma once
+#include <JuceHeader.h>
+#include "synth/WavetableBank.h"
+#include "geometry/Utils.h"
+#include <atomic>
+#include <vector>
+
+// Turns the shape of a Voronoi cell into a wavetable on a background thread.
+//
+// Like GeometryWorker, a request replaces any the generator has not started on yet, and the
+// finished table waits in an atomic mailbox for the audio thread. Every table handed out stays
+// in a release pool until the audio thread has let go of it, so the audio thread never frees
+// one.
+class WavetableGenerator : private juce::Thread,
+                           private juce::Timer
+{
+public:
+   enum class Profile
+   {
+      Radial,   // distance from the site to the cell's edge, all the way round
+      Perimeter // horizontal offset from the site, walking the edge at constant speed
+   };
+
+   WavetableGenerator();
+   ~WavetableGenerator() override;
+
+   // Message thread; polygon is the cell around site, in either winding
+   void requestCell(std::vector<GeoUtils::Point> polygon, const GeoUtils::Point& site, Profile profile);
+
+   // Audio thread; swaps in the newest table if there is one
+   bool pull(Wavetable::Ptr& latest);
+
+   // One cycle of size samples tracing the cell, before band-limiting
+   static std::vector<float> traceCell(const std::vector<GeoUtils::Point>& polygon, const GeoUtils::Point& site,
+                                       Profile profile, int size);
+
+private:
+   struct Request
+   {
+      std::vector<GeoUtils::Point> polygon;
+      GeoUtils::Point site;
+      Profile profile;
+   };
+
+   void run() override;
+   void timerCallback() override;
+
+   std::atomic<Request*> pending{nullptr};
+   std::atomic<Wavetable*> mailbox{nullptr};
+
+   juce::CriticalSection releaseLock;
+   std::vector<Wavetable::Ptr> releasePool;
+
+   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WavetableGenerator)
+};
@@ -1,20 +1,34 @@
 #pragma once
-#include <vector>
+#include "synth/WavetableBank.h"
+#include <cstdint>
 
+// Reads a wavetable with a 32-bit fixed-point phase: the top bits index the table, the rest
+// interpolate between neighbouring samples, and a whole cycle is 2^32 so the phase wraps by
+// itself and never drifts.
 class WavetableOscillator{
 public:
-   WavetableOscillator(std::vector<float> waveTable, double sampleRate);
+   // The table has to stay alive until the oscillator is gone or reads another one
+   WavetableOscillator(const Wavetable& waveTable, double sampleRate);
   
    void setFrequency(float frequency);
-   float getSample();
+   // Swaps the table it reads, keeping its place in the cycle
+   void setWavetable(const Wavetable& newWaveTable);
+
+   // Adds numSamples samples to output, scaled by a gain ramping linearly from startGain
+   // (exclusive) to endGain (reached on the last sample)
+   void renderBlock(float* output, int numSamples, float startGain, float endGain);
+
+   // Back to the start of the cycle, so the voice's next note starts from phase 0, and at
+   // frequency 0 until it is set again
    void stop();
-   bool isPlaying();
 private:
-   std::vector<float> waveTable;
-   double sampleRate;
-   float index = 0.f;
-   float indexIncrement = 0.f;
+   void selectLevel();
 
-   float interpolateLinearly();
+   const Wavetable* waveTable;
+   const float* samples; // the table's level for the current frequency
+   double sampleRate;
+   int indexShift = 32; // phase >> indexShift is the table index
+   uint32_t phase = 0;
+   uint32_t phaseIncrement = 0;
 
-};
\ No newline at end of file
+};
@@ -1,21 +1,94 @@
 #pragma once
 #include <JuceHeader.h>
 #include "synth/WavetableOscillator.h"
+#include "synth/WavetableBank.h"
+#include "synth/VoiceEnvelopes.h"
+#include "synth/VoiceFilters.h"
 #include <vector>
 
+// Plays MIDI notes on a fixed pool of voices. Only voices in the active list are rendered;
+// a note that finds every voice busy takes one over, preferring voices already fading out.
+// Each voice goes through its own lowpass filter before the voices are summed.
 class WavetableSynth
 {
 public:
-   void prepareToPlay(double sampleRate);
+   static constexpr int DEFAULT_POLYPHONY = 32;
+
+   enum class VoiceStealing
+   {
+      Oldest,
+      Quietest
+   };
+
+   // Sizes the pool; the only place voices are allocated
+   void prepareToPlay(double sampleRate, int polyphony = DEFAULT_POLYPHONY);
+   void setVoiceStealing(VoiceStealing mode) { voiceStealing = mode; }
+   // Audio thread; notes already sounding follow the new times from their next sub-block
+   void setEnvelope(const VoiceEnvelopes::Settings& settings) { envelopes.setSettings(settings); }
+   // Audio thread; cutoff in Hz and resonance 0..1, for every voice
+   void setFilter(float cutoff, float resonance) { filters.setBase(cutoff, resonance); }
+   // Audio thread; offsets the filter of the voice the next processBlock starts for the
+   // note-on of note at sample, in octaves and resonance. Each offset goes with its own note-on,
+   // so notes without one play the base filter.
+   void setNoteFilter(int note, int sample, float cutoffOctaves, float resonance);
+   // Audio thread; every voice switches to the bank's table for shape, or with
+   // WavetableBank::NUM_SHAPES to the cell table, playing a sine until there is one
+   void setWaveform(int shape);
+   // Audio thread; the caller keeps the table's last reference, so it is never freed here
+   void setCellWavetable(Wavetable::Ptr table);
    void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages);
 
+   struct VoiceInfo
+   {
+      int note;
+      VoiceEnvelopes::Stage stage;
+      float level; // envelope level at the end of the last block
+   };
+
+   int getNumActiveVoices() const { return static_cast<int>(activeVoices.size()); }
+   // index is below getNumActiveVoices(); the order changes as voices come and go
+   VoiceInfo getActiveVoice(int index) const;
+
 private:
-   std::vector<float> generateSineWavetable(int length);
-   void initializeOscillators();
-   void handleMidiEvent(const juce::MidiMessage& midiEvent);
+   // Level and pitch live in envelopes, under the same index
+   struct Voice
+   {
+      WavetableOscillator oscillator;
+      int note = -1;
+      uint64_t startedAt = 0;
+   };
+
+   struct NoteFilter
+   {
+      int note; // -1 once its note-on has taken it
+      int sample;
+      float cutoffOctaves, resonance;
+   };
+   static constexpr size_t MAX_NOTE_FILTERS = 256; // per block
+
+   void initializeVoices(int polyphony);
+   const Wavetable& getWavetable() const;
+   void switchWavetable();
+   void handleMidiEvent(const juce::MidiMessage& midiEvent, int sample);
    float midiNoteNumberToFrequency(int midiNoteNumber);
    void render(juce::AudioBuffer<float>& buffer, int startSample, int endSample);
 
+   void startNote(int note, float velocity, int sample);
+   void releaseNote(int note);
+   int takeVoice();
+
+   juce::SharedResourcePointer<WavetableBank> bank;
+   Wavetable::Ptr cellTable;
+   int waveform = WavetableBank::Sine;
    double sampleRate;
-   std::vector<WavetableOscillator> oscillators;
-};
\ No newline at end of file
+
+   // Voices sit side by side; activeVoices and freeVoices together hold each index once
+   std::vector<Voice> voices;
+   std::vector<int> activeVoices;
+   std::vector<int> freeVoices;
+   VoiceEnvelopes envelopes;
+   VoiceFilters filters;
+   std::vector<NoteFilter> noteFilters; // for the next block's note-ons, in the order they were set
+   uint64_t notesStarted = 0;
+   VoiceStealing voiceStealing = VoiceStealing::Oldest;
+};
@@ -1,101 +1,202 @@
 #include "Voronoise/PluginEditor.h"
-#include "geometry/Delaunay.h"
-#include "geometry/Voronoi.h"
-// Note: Utils.h is included via the other headers
+// Note: the geometry headers are included via GeometryWorker.h
 
 //==============================================================================
 VoronoiseAudioProcessorEditor::VoronoiseAudioProcessorEditor(VoronoiseAudioProcessor &p)
     : AudioProcessorEditor(&p), processorRef(p), valueTree(p.getValueTree())
 {
-    juce::ignoreUnused(processorRef);
     setSize(400, 300);
+    setWantsKeyboardFocus(true);
+    startTimerHz(60);
 }
 
 VoronoiseAudioProcessorEditor::~VoronoiseAudioProcessorEditor()
 {
+    stopTimer();
 }
 
 //==============================================================================
 void VoronoiseAudioProcessorEditor::paint(juce::Graphics &g)
 {
     g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
+    if (snapshot == nullptr)
+        return;
+
     g.setColour(juce::Colours::white);
     g.setFont(15.0f);
 
-    auto sitesTree = valueTree.getChildWithName("Sites");
-    points.clear();
-
-    for (int i = 0; i < sitesTree.getNumChildren(); i++)
+    g.strokePath(snapshot->sitesPath, juce::PathStrokeType(1.5f));
+    if (snapshot->sites.size() > 2)
     {
-        auto site = sitesTree.getChild(i);
-        double x = static_cast<double>(site["x"]);
-        double y = static_cast<double>(site["y"]);
+        g.drawFittedText("Points: " + juce::String(snapshot->sites.size()) + ", Triangles: " + juce::String(snapshot->mesh.numTriangles()),
+                         getLocalBounds().reduced(10), juce::Justification::topRight, 1);
+    }
 
-        points.push_back(GeoUtils::Point(x, y));
+    g.setColour(juce::Colours::aqua);
+    g.strokePath(snapshot->cellsPath, juce::PathStrokeType(1.5f));
 
-        g.drawEllipse(static_cast<float>(x) - 2.f, static_cast<float>(y) - 2.f, 4.f, 4.f, 1.5f);
-    }
+    g.setColour(juce::Colours::grey);
+    g.strokePath(snapshot->trianglesPath, juce::PathStrokeType(1.5f));
+}
 
-    if (points.size() > 2)
-    {
-        std::vector<GeoUtils::Triangle> triangles = Delaunay::triangulate(points);
+void VoronoiseAudioProcessorEditor::resized()
+{
+    // Cells are clipped to the editor bounds
+    auto box = getLocalBounds().toDouble();
+    processorRef.setDiagramBounds({box.getX(), box.getY(), box.getRight(), box.getBottom()});
+}
 
-        GeoUtils::BBox bbox;
-        auto box = getLocalBounds().toDouble();
-        bbox.minX = box.getX();
-        bbox.minY = box.getY();
-        bbox.maxX = box.getRight();
-        bbox.maxY = box.getBottom();
+void VoronoiseAudioProcessorEditor::timerCallback()
+{
+    if (!processorRef.getGeometryWorker().pullForEditor(snapshot))
+        return;
 
-        auto voronoiCells = Voronoi::getCells(triangles, bbox);
+    // Each step starts from the diagram of the last, so the sites settle at the worker's pace
+    if (relaxing && draggedSite < 0)
+        relaxSites();
+    repaint();
+}
 
-        g.drawFittedText("Points: " + juce::String(points.size()) + ", Triangles: " + juce::String(triangles.size()),
-                         getLocalBounds().reduced(10), juce::Justification::topRight, 1);
+void VoronoiseAudioProcessorEditor::relaxSites()
+{
+    // Only a fraction of the way per frame, so the motion is smooth and the worker repairs the
+    // previous triangulation rather than building a new one
+    constexpr double relaxRate = 0.25;
 
-        g.setColour(juce::Colours::aqua);
+    auto sitesTree = getSitesTree();
+    if (snapshot == nullptr || snapshot->sites.size() != static_cast<size_t>(sitesTree.getNumChildren()))
+        return;
 
-        for (const auto &kv : voronoiCells)
-        {
-            const auto &cell = kv.second;
-            const auto &verts = cell.vertices;
-            if (verts.size() < 2)
-                continue;
-
-            for (size_t i = 0; i < verts.size(); ++i)
-            {
-                g.drawLine((float)verts[i].getX(), (float)verts[i].getY(),
-                           (float)verts[(i + 1) % verts.size()].getX(), (float)verts[(i + 1) % verts.size()].getY(), 1.5f);
-            }
-        }
+    Voronoi::getCentroids(snapshot->diagram, centroids, cellAreas);
+    for (size_t cell = 0; cell < centroids.size(); ++cell)
+    {
+        const int i = snapshot->cellSites[cell];
+        if (i < 0 || cellAreas[cell] <= 0.0)
+            continue;
+
+        const auto& site = snapshot->sites[static_cast<size_t>(i)];
+        const auto target = site + (centroids[cell] - site) * relaxRate;
+        sitesTree.getChild(i)
+            .setProperty("x", target.x, nullptr)
+            .setProperty("y", target.y, nullptr);
+    }
+}
 
-        g.setColour(juce::Colours::grey);
+void VoronoiseAudioProcessorEditor::mouseDoubleClick(const juce::MouseEvent &event)
+{
+    getSitesTree().appendChild(
+        juce::ValueTree("Site")
+            .setProperty("x", static_cast<double>(event.x), nullptr)
+            .setProperty("y", static_cast<double>(event.y), nullptr),
+        nullptr);
+}
+
+void VoronoiseAudioProcessorEditor::mouseDown(const juce::MouseEvent &event)
+{
+    // Alt-click turns the shape of the cell under the cursor into the synth's "Cell" waveform
+    if (event.mods.isAltDown() && snapshot != nullptr)
+    {
+        lastCell = snapshot->locator.findCell(event.position.toDouble(), lastCell);
+        if (lastCell < 0)
+            return;
+
+        const auto &diagram = snapshot->diagram;
+        const auto cell = static_cast<size_t>(lastCell);
+        std::vector<GeoUtils::Point> polygon;
+        for (int k = 0; k < diagram.cellSize(cell); ++k)
+            polygon.push_back(diagram.cellVertex(cell, k));
+        processorRef.requestCellWavetable(std::move(polygon), diagram.sites[cell]);
+        return;
+    }
 
-        for (const auto &t : triangles)
+    draggedSite = findSiteAt(event.position);
+    if (draggedSite < 0 && event.mods.isShiftDown())
+    {
+        // Shift-click on empty space launches a ball in a random direction, pitched higher
+        // towards the top of the diagram
+        auto& random = juce::Random::getSystemRandom();
+        Ball ball;
+        ball.position = event.position.toDouble();
+        ball.angle = random.nextFloat() * juce::MathConstants<float>::twoPi;
+        ball.color = juce::Colour::fromHSV(random.nextFloat(), 0.7f, 1.f, 1.f);
+        const float height = 1.f - event.position.y / static_cast<float>(juce::jmax(1, getHeight()));
+        ball.frequency = 110.f * std::pow(2.f, 4.f * juce::jlimit(0.f, 1.f, height));
+
+        // The cell it starts in is the one it stays in, and whose features it plays with
+        if (snapshot != nullptr)
         {
-            g.drawLine(static_cast<float>(t.a.getX()), static_cast<float>(t.a.getY()),
-                       static_cast<float>(t.b.getX()), static_cast<float>(t.b.getY()), 1.5f);
-            g.drawLine(static_cast<float>(t.b.getX()), static_cast<float>(t.b.getY()),
-                       static_cast<float>(t.c.getX()), static_cast<float>(t.c.getY()), 1.5f);
-            g.drawLine(static_cast<float>(t.c.getX()), static_cast<float>(t.c.getY()),
-                       static_cast<float>(t.a.getX()), static_cast<float>(t.a.getY()), 1.5f);
+            lastCell = snapshot->locator.findCell(ball.position, lastCell);
+            ball.site = lastCell >= 0 ? snapshot->cellSites[static_cast<size_t>(lastCell)] : -1;
         }
+        processorRef.launchBall(ball);
+        return;
     }
+    if (draggedSite < 0 || !event.mods.isPopupMenu())
+        return;
+
+    // Right-click removes the site under the cursor
+    getSitesTree().removeChild(draggedSite, nullptr);
+    draggedSite = -1;
 }
 
-void VoronoiseAudioProcessorEditor::resized()
+void VoronoiseAudioProcessorEditor::mouseDrag(const juce::MouseEvent &event)
 {
+    if (draggedSite < 0)
+        return;
+
+    auto position = getLocalBounds().toFloat().getConstrainedPoint(event.position).toDouble();
+    getSitesTree().getChild(draggedSite)
+        .setProperty("x", position.x, nullptr)
+        .setProperty("y", position.y, nullptr);
 }
 
-void VoronoiseAudioProcessorEditor::mouseDoubleClick(const juce::MouseEvent &event)
+void VoronoiseAudioProcessorEditor::mouseUp(const juce::MouseEvent &)
 {
-    GeoUtils::Point point(event.x, event.y);
-    points.push_back(point);
-    repaint();
-    
-    auto sitesTree = valueTree.getChildWithName("Sites");
-    sitesTree.appendChild(
-        juce::ValueTree("Site")
-            .setProperty("x", static_cast<double>(event.x), nullptr)
-            .setProperty("y", static_cast<double>(event.y), nullptr),
-        nullptr);
+    draggedSite = -1;
+}
+
+bool VoronoiseAudioProcessorEditor::keyPressed(const juce::KeyPress &key)
+{
+    if (key.getTextCharacter() != 'r')
+        return false;
+
+    relaxing = !relaxing;
+    return true;
+}
+
+int VoronoiseAudioProcessorEditor::findSiteAt(juce::Point<float> position) const
+{
+    constexpr double grabRadiusSq = 6.0 * 6.0;
+
+    auto sitesTree = getSitesTree();
+    auto sitePosition = [&sitesTree](int i)
+    {
+        auto site = sitesTree.getChild(i);
+        return GeoUtils::Point{static_cast<double>(site["x"]), static_cast<double>(site["y"])};
+    };
+
+    // The snapshot's nearest site is the one under the cursor, as long as the snapshot still
+    // has every site of the tree; positions are read from the tree, which may be newer
+    if (snapshot != nullptr && snapshot->sites.size() == static_cast<size_t>(sitesTree.getNumChildren()))
+    {
+        lastCell = snapshot->locator.findCell(position.toDouble(), lastCell);
+        const int site = lastCell >= 0 ? snapshot->cellSites[static_cast<size_t>(lastCell)] : -1;
+        if (site >= 0)
+            return sitePosition(site).getDistanceSquaredFrom(position.toDouble()) <= grabRadiusSq ? site : -1;
+    }
+
+    // Sites the worker has not caught up with yet, or a layout too degenerate for a mesh, where
+    // the locator may pick a removed site
+    int closest = -1;
+    double closestDistSq = grabRadiusSq;
+    for (int i = 0; i < sitesTree.getNumChildren(); ++i)
+    {
+        double distSq = sitePosition(i).getDistanceSquaredFrom(position.toDouble());
+        if (distSq <= closestDistSq)
+        {
+            closest = i;
+            closestDistSq = distSq;
+        }
+    }
+    return closest;
 }
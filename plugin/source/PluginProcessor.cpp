@@ -15,10 +15,24 @@ VoronoiseAudioProcessor::VoronoiseAudioProcessor()
     // for use in storing sites a user adds in the grid
     if (! apvts.state.getChildWithName("Sites").isValid())
     apvts.state.addChild({ "Sites", {}, {} }, -1, nullptr);
+
+    apvts.state.addListener(this);
+    resetSiteKeys();
+    modMatrix.attach(apvts);
+    waveform = apvts.getRawParameterValue("waveform");
+    attack = apvts.getRawParameterValue("attack");
+    decay = apvts.getRawParameterValue("decay");
+    sustain = apvts.getRawParameterValue("sustain");
+    release = apvts.getRawParameterValue("release");
+    cutoff = apvts.getRawParameterValue("cutoff");
+    resonance = apvts.getRawParameterValue("resonance");
+    handleAsyncUpdate();
 }
 
 VoronoiseAudioProcessor::~VoronoiseAudioProcessor()
 {
+    apvts.state.removeListener(this);
+    cancelPendingUpdate();
 }
 
 //==============================================================================
@@ -92,6 +106,11 @@ void VoronoiseAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBl
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
     synth.prepareToPlay(sampleRate);
+    balls.prepare(sampleRate, maxBalls);
+    modMatrix.prepareToPlay(sampleRate);
+    lastGain = 1.f;
+    ballNotes.clear();
+    ballNotes.reserve(static_cast<size_t>(maxBalls) * 4);
     samplesPerBlock; // currently here just to get rid of warning, will do smth with this later prob
 }
 
@@ -127,6 +146,25 @@ bool VoronoiseAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts
 
 juce::AudioProcessorValueTreeState::ParameterLayout VoronoiseAudioProcessor::createParameterLayout() {
     juce::AudioProcessorValueTreeState::ParameterLayout layout; 
+    // The last choice plays the wavetable traced from a cell
+    auto waveforms = WavetableBank::getShapeNames();
+    waveforms.add("Cell");
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{"waveform", 1}, "Waveform", waveforms, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID{"cellProfile", 1}, "Cell Profile",
+                                                            juce::StringArray{"Radial", "Perimeter"}, 0));
+    // Envelope times in seconds, skewed so the short end gets most of the travel
+    const auto times = juce::NormalisableRange<float>(0.001f, 5.f, 0.f, 0.3f);
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"attack", 1}, "Attack", times, 0.005f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"decay", 1}, "Decay", times, 0.3f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"sustain", 1}, "Sustain",
+                                                           juce::NormalisableRange<float>(0.f, 1.f), 0.7f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"release", 1}, "Release", times, 0.3f));
+    // Every voice's own lowpass; starts fully open
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"cutoff", 1}, "Cutoff",
+                                                           juce::NormalisableRange<float>(20.f, 20000.f, 0.f, 0.25f), 20000.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID{"resonance", 1}, "Resonance",
+                                                           juce::NormalisableRange<float>(0.f, 1.f), 0.f));
+    ModMatrix::addParameters(layout);
     return layout;
 }
 
@@ -134,6 +172,91 @@ juce::ValueTree VoronoiseAudioProcessor::getValueTree() {
     return apvts.state;
 }
 
+void VoronoiseAudioProcessor::setDiagramBounds (const GeoUtils::BBox& bounds)
+{
+    diagramBounds = bounds;
+    triggerAsyncUpdate();
+}
+
+void VoronoiseAudioProcessor::requestCellWavetable (std::vector<GeoUtils::Point> polygon, const GeoUtils::Point& site)
+{
+    const auto profile = juce::roundToInt(apvts.getRawParameterValue("cellProfile")->load()) == 0
+                             ? WavetableGenerator::Profile::Radial
+                             : WavetableGenerator::Profile::Perimeter;
+    wavetableGenerator.requestCell(std::move(polygon), site, profile);
+}
+
+void VoronoiseAudioProcessor::valueTreeChildAdded (juce::ValueTree& parent, juce::ValueTree& child)
+{
+    if (parent.hasType("Sites"))
+    {
+        siteKeys.insert(siteKeys.begin() + parent.indexOf(child), nextSiteKey++);
+        triggerAsyncUpdate();
+    }
+    else if (child.hasType("Sites"))
+    {
+        resetSiteKeys();
+        triggerAsyncUpdate();
+    }
+}
+
+void VoronoiseAudioProcessor::valueTreeChildRemoved (juce::ValueTree& parent, juce::ValueTree&, int index)
+{
+    if (parent.hasType("Sites"))
+    {
+        siteKeys.erase(siteKeys.begin() + index);
+        triggerAsyncUpdate();
+    }
+}
+
+void VoronoiseAudioProcessor::valueTreeChildOrderChanged (juce::ValueTree& parent, int oldIndex, int newIndex)
+{
+    if (parent.hasType("Sites"))
+    {
+        const int key = siteKeys[static_cast<size_t>(oldIndex)];
+        siteKeys.erase(siteKeys.begin() + oldIndex);
+        siteKeys.insert(siteKeys.begin() + newIndex, key);
+        triggerAsyncUpdate();
+    }
+}
+
+void VoronoiseAudioProcessor::valueTreePropertyChanged (juce::ValueTree& tree, const juce::Identifier& property)
+{
+    if (tree.hasType("Site") && (property == juce::Identifier("x") || property == juce::Identifier("y")))
+        triggerAsyncUpdate();
+}
+
+void VoronoiseAudioProcessor::valueTreeRedirected (juce::ValueTree&)
+{
+    resetSiteKeys();
+    triggerAsyncUpdate();
+}
+
+// Every site gets a fresh key, so the worker treats them all as new
+void VoronoiseAudioProcessor::resetSiteKeys()
+{
+    const int numSites = apvts.state.getChildWithName("Sites").getNumChildren();
+    siteKeys.resize(static_cast<size_t>(numSites));
+    for (auto& key : siteKeys)
+        key = nextSiteKey++;
+}
+
+void VoronoiseAudioProcessor::handleAsyncUpdate()
+{
+    auto sitesTree = apvts.state.getChildWithName("Sites");
+    std::vector<GeoUtils::Point> sites;
+    sites.reserve(static_cast<size_t>(sitesTree.getNumChildren()));
+
+    for (int i = 0; i < sitesTree.getNumChildren(); i++)
+    {
+        auto site = sitesTree.getChild(i);
+        sites.push_back({static_cast<double>(site["x"]), static_cast<double>(site["y"])});
+    }
+
+    jassert(siteKeys.size() == sites.size());
+    geometryWorker.requestRebuild(std::move(sites), siteKeys, diagramBounds);
+}
+
 void VoronoiseAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
                                               juce::MidiBuffer& midiMessages)
 {
@@ -143,7 +266,46 @@ void VoronoiseAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
 
     buffer.clear();
 
+    // Never blocks; the previous snapshot stays in use until a newer one has been published
+    geometryWorker.pullForAudio(geometry);
+
+    Ball launched;
+    while (ballLaunches.pull(launched))
+        balls.launch(launched);
+
+    // Impacts are played by the synth below, at the sample they happened on
+    if (geometry != nullptr)
+    {
+        ballNotes.clear();
+        balls.process(buffer.getNumSamples(), geometry->edgeGrid, ballNotes);
+        for (const auto& ballNote : ballNotes)
+        {
+            auto message = ballNote.velocity > 0.f ? juce::MidiMessage::noteOn(1, ballNote.note, ballNote.velocity)
+                                                   : juce::MidiMessage::noteOff(1, ballNote.note);
+            midiMessages.addEvent(message, ballNote.sample);
+
+            // The feature table is indexed like the snapshot's sites, which a ball launched
+            // before the last edit may no longer match
+            if (ballNote.velocity > 0.f && ballNote.site >= 0 && static_cast<size_t>(ballNote.site) < geometry->features.numRows())
+            {
+                const auto row = geometry->features.getRow(static_cast<size_t>(ballNote.site));
+                modMatrix.setSources(row);
+
+                // The note's own filter follows its cell, however many other notes are playing
+                synth.setNoteFilter(ballNote.note, ballNote.sample, 3.f * modMatrix.evaluate(ModMatrix::FilterCutoff, row),
+                                    0.3f * modMatrix.evaluate(ModMatrix::FilterResonance, row));
+            }
+        }
+    }
+
+    Wavetable::Ptr cellTable;
+    if (wavetableGenerator.pull(cellTable))
+        synth.setCellWavetable(std::move(cellTable));
+    synth.setWaveform(juce::roundToInt(waveform->load()));
+    synth.setEnvelope({attack->load(), decay->load(), sustain->load(), release->load()});
+    synth.setFilter(cutoff->load(), resonance->load());
     synth.processBlock(buffer,midiMessages);
+    applyModulation(buffer);
 
     auto newDSPOrder = DSP_Order();
 
@@ -184,6 +346,16 @@ void VoronoiseAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     }
 }
 
+void VoronoiseAudioProcessor::applyModulation (juce::AudioBuffer<float>& buffer)
+{
+    modMatrix.advance(buffer.getNumSamples());
+
+    // Swings either way around unity; the filter destinations go to each note's voice instead
+    const float gain = juce::Decibels::decibelsToGain(12.f * modMatrix.getValue(ModMatrix::Gain));
+    buffer.applyGainRamp(0, buffer.getNumSamples(), lastGain, gain);
+    lastGain = gain;
+}
+
 //==============================================================================
 bool VoronoiseAudioProcessor::hasEditor() const
 {
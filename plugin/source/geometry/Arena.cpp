@@ -0,0 +1,44 @@
+#include "geometry/Arena.h"
+
+namespace GeoUtils
+{
+   Arena::Arena(size_t initialBytes) : blockSize(initialBytes)
+   {
+      if (blockSize > 0)
+         block = std::make_unique<std::byte[]>(blockSize);
+      startBlock();
+   }
+
+   void Arena::reset()
+   {
+      // Release before growing, so the heap blocks go back before the bigger one is taken
+      bump->release();
+      if (overflow.bytes == 0)
+         return;
+
+      blockSize += overflow.bytes;
+      overflow.bytes = 0;
+      block.reset();
+      block = std::make_unique<std::byte[]>(blockSize);
+      startBlock();
+   }
+
+   void Arena::startBlock()
+   {
+      if (blockSize > 0)
+         bump.emplace(block.get(), blockSize, &overflow);
+      else
+         bump.emplace(&overflow);
+   }
+
+   void *Arena::Overflow::do_allocate(size_t size, size_t alignment)
+   {
+      bytes += size;
+      return std::pmr::new_delete_resource()->allocate(size, alignment);
+   }
+
+   void Arena::Overflow::do_deallocate(void *ptr, size_t size, size_t alignment)
+   {
+      std::pmr::new_delete_resource()->deallocate(ptr, size, alignment);
+   }
+}
@@ -0,0 +1,75 @@
+#include "geometry/CellFeatures.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Voronoi
+{
+   void CellFeatures::build(const GeoUtils::Mesh &mesh, const Diagram &diagram, const GeoUtils::BBox &bounds,
+                            const std::vector<int> &cellSites, size_t numRows)
+   {
+      for (auto &feature : values)
+         feature.assign(numRows, 0.f);
+
+      // A site has one outgoing half-edge per triangle around it; a hull site also has the
+      // hull edge that ends at it
+      neighbourCounts.assign(mesh.points.size(), 0);
+      for (size_t e = 0; e < mesh.triangles.size(); ++e)
+      {
+         ++neighbourCounts[mesh.triangles[e]];
+         if (mesh.halfedges[e] == GeoUtils::NO_HALFEDGE)
+            ++neighbourCounts[mesh.triangles[GeoUtils::nextHalfedge(static_cast<int>(e))]];
+      }
+
+      const double centreX = 0.5 * (bounds.minX + bounds.maxX), centreY = 0.5 * (bounds.minY + bounds.maxY);
+      const double halfDiagonal = 0.5 * std::hypot(bounds.maxX - bounds.minX, bounds.maxY - bounds.minY);
+
+      // Raw values first, then each feature is scaled by its largest value
+      std::array<float, NUM_FEATURES> largest{};
+      for (size_t c = 0; c < diagram.numCells(); ++c)
+      {
+         const int row = c < cellSites.size() ? cellSites[c] : -1;
+         if (row < 0 || static_cast<size_t>(row) >= numRows)
+            continue;
+
+         const int n = diagram.cellSize(c);
+         double area = 0.0, perimeter = 0.0;
+         for (int k = 0; k < n; ++k)
+         {
+            const auto &a = diagram.cellVertex(c, k);
+            const auto &b = diagram.cellVertex(c, (k + 1) % n);
+            area += a.x * b.y - b.x * a.y;
+            perimeter += a.getDistanceFrom(b);
+         }
+
+         const auto &site = diagram.sites[c];
+         const float raw[NUM_FEATURES] = {
+             static_cast<float>(std::max(0.5 * area, 0.0)),
+             static_cast<float>(perimeter),
+             static_cast<float>(c < neighbourCounts.size() ? neighbourCounts[c] : 0),
+             static_cast<float>(halfDiagonal > 0.0 ? std::min(std::hypot(site.x - centreX, site.y - centreY) / halfDiagonal, 1.0) : 0.0),
+             static_cast<float>(n)};
+         for (int f = 0; f < NUM_FEATURES; ++f)
+         {
+            values[f][row] = raw[f];
+            largest[f] = std::max(largest[f], raw[f]);
+         }
+      }
+
+      for (int f = 0; f < NUM_FEATURES; ++f)
+      {
+         if (f == CentreDistance || largest[f] <= 0.f)
+            continue;
+         const float scale = 1.f / largest[f];
+         for (auto &value : values[f])
+            value *= scale;
+      }
+   }
+
+   std::array<float, CellFeatures::NUM_FEATURES> CellFeatures::getRow(size_t row) const
+   {
+      std::array<float, NUM_FEATURES> result;
+      for (int f = 0; f < NUM_FEATURES; ++f)
+         result[f] = values[f][row];
+      return result;
+   }
+}
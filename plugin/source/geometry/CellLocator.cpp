@@ -0,0 +1,169 @@
+#include "geometry/CellLocator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Voronoi
+{
+   namespace
+   {
+      double distanceSq(const GeoUtils::Point &a, const GeoUtils::Point &b)
+      {
+         const double dx = a.x - b.x;
+         const double dy = a.y - b.y;
+         return dx * dx + dy * dy;
+      }
+
+      // Keeps the grid near one bucket per site without letting a long thin point set run away
+      constexpr int MAX_COLUMNS = 4096;
+   }
+
+   void CellLocator::build(const GeoUtils::Mesh &mesh)
+   {
+      points.assign(mesh.points.begin(), mesh.points.end());
+      const int numPoints = static_cast<int>(points.size());
+
+      // Every undirected edge is seen from both of its half-edges, except on the hull
+      neighbourOffsets.assign(numPoints + 1, 0);
+      for (size_t e = 0; e < mesh.triangles.size(); ++e)
+      {
+         ++neighbourOffsets[mesh.triangles[e] + 1];
+         if (mesh.halfedges[e] == GeoUtils::NO_HALFEDGE)
+            ++neighbourOffsets[mesh.triangles[GeoUtils::nextHalfedge(static_cast<int>(e))] + 1];
+      }
+      for (int i = 0; i < numPoints; ++i)
+         neighbourOffsets[i + 1] += neighbourOffsets[i];
+
+      neighbours.resize(neighbourOffsets[numPoints]);
+      for (size_t e = 0; e < mesh.triangles.size(); ++e)
+      {
+         const int from = mesh.triangles[e];
+         const int to = mesh.triangles[GeoUtils::nextHalfedge(static_cast<int>(e))];
+         neighbours[--neighbourOffsets[from + 1]] = to;
+         if (mesh.halfedges[e] == GeoUtils::NO_HALFEDGE)
+            neighbours[--neighbourOffsets[to + 1]] = from;
+      }
+      // Filling each run from its back moved offset i + 1 down to the start of site i's run
+      for (int i = 0; i < numPoints; ++i)
+         neighbourOffsets[i] = neighbourOffsets[i + 1];
+      neighbourOffsets[numPoints] = static_cast<int>(neighbours.size());
+
+      bucketSites.clear();
+      columns = rows = 0;
+      if (mesh.triangles.empty())
+         return;
+
+      double minX = std::numeric_limits<double>::max(), minY = minX;
+      double maxX = std::numeric_limits<double>::lowest(), maxY = maxX;
+      int numSites = 0;
+      for (int i = 0; i < numPoints; ++i)
+      {
+         if (!inMesh(i))
+            continue;
+         minX = std::min(minX, points[i].x);
+         minY = std::min(minY, points[i].y);
+         maxX = std::max(maxX, points[i].x);
+         maxY = std::max(maxY, points[i].y);
+         ++numSites;
+      }
+
+      // Square buckets of about one site each; a mesh has area, so neither side is zero
+      const double width = maxX - minX, height = maxY - minY;
+      const double bucketSize = std::sqrt(width * height / numSites);
+      columns = static_cast<int>(std::min(width / bucketSize, MAX_COLUMNS - 1.0)) + 1;
+      rows = static_cast<int>(std::min(height / bucketSize, MAX_COLUMNS - 1.0)) + 1;
+      originX = minX;
+      originY = minY;
+      bucketScale = 1.0 / bucketSize;
+
+      // Each bucket starts from the site nearest its centre
+      bucketSites.assign(static_cast<size_t>(columns) * rows, -1);
+      auto centreOf = [this, bucketSize](int b)
+      {
+         return GeoUtils::Point{originX + ((b % columns) + 0.5) * bucketSize, originY + ((b / columns) + 0.5) * bucketSize};
+      };
+      auto offer = [this, &centreOf](int b, int site)
+      {
+         if (site >= 0 && (bucketSites[b] < 0 || distanceSq(points[site], centreOf(b)) < distanceSq(points[bucketSites[b]], centreOf(b))))
+            bucketSites[b] = site;
+      };
+      for (int i = 0; i < numPoints; ++i)
+      {
+         if (inMesh(i))
+            offer(bucketOf(points[i]), i);
+      }
+
+      // Buckets also consider their neighbours' starts, sweeping down and then back up, so that
+      // empty buckets in the gaps between clusters start from a site close by
+      const int numBuckets = columns * rows;
+      for (int b = 0; b < numBuckets; ++b)
+      {
+         if (b % columns > 0)
+            offer(b, bucketSites[b - 1]);
+         if (b >= columns)
+            offer(b, bucketSites[b - columns]);
+      }
+      for (int b = numBuckets - 1; b >= 0; --b)
+      {
+         if (b % columns < columns - 1)
+            offer(b, bucketSites[b + 1]);
+         if (b + columns < numBuckets)
+            offer(b, bucketSites[b + columns]);
+      }
+   }
+
+   int CellLocator::findCell(const GeoUtils::Point &p, int hint) const
+   {
+      if (bucketSites.empty())
+      {
+         // Too few sites for a mesh: they are few or all on one line, so look at each
+         int nearest = -1;
+         double best = std::numeric_limits<double>::max();
+         for (int i = 0; i < static_cast<int>(points.size()); ++i)
+         {
+            const double d = distanceSq(p, points[i]);
+            if (d < best)
+            {
+               best = d;
+               nearest = i;
+            }
+         }
+         return nearest;
+      }
+
+      const bool hintUsable = hint >= 0 && hint < static_cast<int>(points.size()) && inMesh(hint);
+      return walk(p, hintUsable ? hint : bucketSites[bucketOf(p)]);
+   }
+
+   // Moves to the closest neighbour until no neighbour is closer. If a site is not the one
+   // nearest p, one of its Delaunay neighbours is nearer, so the walk stops at the nearest site.
+   int CellLocator::walk(const GeoUtils::Point &p, int start) const
+   {
+      int current = start;
+      double best = distanceSq(p, points[current]);
+      while (true)
+      {
+         int next = current;
+         for (int k = neighbourOffsets[current]; k < neighbourOffsets[current + 1]; ++k)
+         {
+            const double d = distanceSq(p, points[neighbours[k]]);
+            if (d < best)
+            {
+               best = d;
+               next = neighbours[k];
+            }
+         }
+         if (next == current)
+            return current;
+         current = next;
+      }
+   }
+
+   // Points outside the grid use the nearest bucket on its border
+   int CellLocator::bucketOf(const GeoUtils::Point &p) const
+   {
+      const double column = std::clamp((p.x - originX) * bucketScale, 0.0, static_cast<double>(columns - 1));
+      const double row = std::clamp((p.y - originY) * bucketScale, 0.0, static_cast<double>(rows - 1));
+      return static_cast<int>(row) * columns + static_cast<int>(column);
+   }
+}
@@ -0,0 +1,58 @@
+#include "geometry/EdgeGrid.h"
+#include <cmath>
+
+namespace GeoUtils
+{
+   namespace
+   {
+      // Keeps a long thin box from asking for a huge grid
+      constexpr int MAX_COLUMNS = 1024;
+   }
+
+   void EdgeGrid::build(const std::vector<Edge> &edges, const BBox &bounds)
+   {
+      numSourceEdges = edges.size();
+      bucketOffsets.clear();
+      entries.clear();
+      columns = rows = 0;
+      if (edges.empty())
+         return;
+
+      // About two edges to a bucket; a Voronoi edge is then mostly filed in one or two buckets
+      const double width = std::max(bounds.maxX - bounds.minX, 0.0), height = std::max(bounds.maxY - bounds.minY, 0.0);
+      const double area = width * height;
+      const double bucketSize = area > 0.0 ? std::sqrt(2.0 * area / static_cast<double>(edges.size())) : std::max({width, height, 1.0});
+      columns = static_cast<int>(std::min(width / bucketSize, MAX_COLUMNS - 1.0)) + 1;
+      rows = static_cast<int>(std::min(height / bucketSize, MAX_COLUMNS - 1.0)) + 1;
+      originX = bounds.minX;
+      originY = bounds.minY;
+      bucketScale = 1.0 / bucketSize;
+
+      auto forEachBucket = [this](const Edge &edge, auto &&file)
+      {
+         const int firstColumn = columnOf(std::min(edge.u.x, edge.v.x)), lastColumn = columnOf(std::max(edge.u.x, edge.v.x));
+         const int firstRow = rowOf(std::min(edge.u.y, edge.v.y)), lastRow = rowOf(std::max(edge.u.y, edge.v.y));
+         for (int row = firstRow; row <= lastRow; ++row)
+         {
+            for (int column = firstColumn; column <= lastColumn; ++column)
+               file(row * columns + column, Entry{edge, firstColumn, firstRow});
+         }
+      };
+
+      // Count, then fill each bucket's run from the back, as in CellLocator
+      bucketOffsets.assign(static_cast<size_t>(columns) * rows + 1, 0);
+      for (const auto &edge : edges)
+         forEachBucket(edge, [this](int bucket, const Entry &)
+                       { ++bucketOffsets[bucket + 1]; });
+      for (size_t b = 1; b < bucketOffsets.size(); ++b)
+         bucketOffsets[b] += bucketOffsets[b - 1];
+
+      entries.resize(bucketOffsets.back());
+      for (const auto &edge : edges)
+         forEachBucket(edge, [this](int bucket, const Entry &entry)
+                       { entries[--bucketOffsets[bucket + 1]] = entry; });
+      for (size_t b = 0; b + 1 < bucketOffsets.size(); ++b)
+         bucketOffsets[b] = bucketOffsets[b + 1];
+      bucketOffsets.back() = static_cast<int>(entries.size());
+   }
+}
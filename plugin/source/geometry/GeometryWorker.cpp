@@ -0,0 +1,241 @@
+#include "geometry/GeometryWorker.h"
+#include <algorithm>
+#include <memory>
+#include <numeric>
+
+GeometryWorker::GeometryWorker() : juce::Thread("Voronoise geometry")
+{
+   startThread(juce::Thread::Priority::low);
+   startTimer(500);
+}
+
+GeometryWorker::~GeometryWorker()
+{
+   stopTimer();
+   stopThread(2000);
+
+   delete pending.exchange(nullptr);
+   post(editorMailbox, nullptr);
+   post(audioMailbox, nullptr);
+}
+
+void GeometryWorker::requestRebuild(std::vector<GeoUtils::Point> sites, std::vector<int> keys, const GeoUtils::BBox &bounds)
+{
+   jassert(keys.size() == sites.size());
+   auto *request = new Request{std::move(sites), std::move(keys), bounds};
+   delete pending.exchange(request, std::memory_order_acq_rel);
+   notify();
+}
+
+void GeometryWorker::run()
+{
+   while (!threadShouldExit())
+   {
+      std::unique_ptr<Request> request(pending.exchange(nullptr, std::memory_order_acq_rel));
+      if (request == nullptr)
+      {
+         wait(-1);
+         continue;
+      }
+
+      publish(build(*request));
+   }
+}
+
+GeometrySnapshot::Ptr GeometryWorker::build(const Request &request)
+{
+   // A site moved by less than about half the mean spacing mostly stays among its neighbours
+   // and is repaired by a few edge flips, so small moves do not count towards a full rebuild;
+   // a relaxation step moves every site, but only a little
+   const auto &box = request.bounds;
+   const double meanCellArea = (box.maxX - box.minX) * (box.maxY - box.minY) / static_cast<double>(std::max<size_t>(request.sites.size(), 1));
+   const double shortMoveSq = 0.25 * meanCellArea;
+   const uint64_t stamp = version + 1;
+
+   // Sites are matched by key, so removing one is one edit however many sites follow it
+   size_t edits = 0, kept = 0;
+   for (size_t i = 0; i < request.sites.size(); ++i)
+   {
+      auto it = currentSites.find(request.keys[i]);
+      if (it == currentSites.end())
+      {
+         ++edits;
+         continue;
+      }
+      it->second.seen = stamp;
+      ++kept;
+      edits += it->second.position.getDistanceSquaredFrom(request.sites[i]) > shortMoveSq ? 1 : 0;
+   }
+   edits += currentSites.size() - kept;
+
+   siteIds.resize(request.sites.size());
+   if (edits > request.sites.size() / 2)
+   {
+      // Mostly new sites, e.g. a loaded or generated pattern: build from scratch on every core
+      triangulation.build(request.sites, taskPool.get());
+      std::iota(siteIds.begin(), siteIds.end(), 0);
+      currentSites.clear();
+   }
+   else
+   {
+      // Apply the difference to the persistent triangulation, so only edited neighbourhoods are
+      // repaired; moved sites go together, so a relaxation step is one pass of edge flips
+      for (auto it = currentSites.begin(); it != currentSites.end();)
+      {
+         if (it->second.seen == stamp)
+         {
+            ++it;
+            continue;
+         }
+         triangulation.removeSite(it->second.id);
+         it = currentSites.erase(it);
+      }
+
+      movedIds.clear();
+      movedTargets.clear();
+      for (size_t i = 0; i < request.sites.size(); ++i)
+      {
+         auto it = currentSites.find(request.keys[i]);
+         if (it == currentSites.end())
+            continue;
+         siteIds[i] = it->second.id;
+         movedIds.push_back(it->second.id);
+         movedTargets.push_back(request.sites[i]);
+      }
+      triangulation.moveSites(movedIds.data(), movedTargets.data(), movedIds.size());
+
+      for (size_t i = 0; i < request.sites.size(); ++i)
+         if (currentSites.find(request.keys[i]) == currentSites.end())
+            siteIds[i] = triangulation.insertSite(request.sites[i]);
+   }
+
+   for (size_t i = 0; i < request.sites.size(); ++i)
+      currentSites[request.keys[i]] = {siteIds[i], request.sites[i], stamp};
+
+   GeometrySnapshot::Ptr snapshot = takeSpareSnapshot();
+   snapshot->version = ++version;
+   snapshot->bounds = request.bounds;
+   snapshot->sites = request.sites;
+   triangulation.getMesh(snapshot->mesh, meshScratch);
+   Voronoi::getDiagram(snapshot->mesh, request.bounds, snapshot->diagram, voronoiWorkspace, taskPool.get());
+   snapshot->locator.build(snapshot->mesh);
+
+   snapshot->cellSites.assign(snapshot->mesh.points.size(), -1);
+   for (size_t i = 0; i < siteIds.size(); ++i)
+      snapshot->cellSites[siteIds[i]] = static_cast<int>(i);
+   snapshot->features.build(snapshot->mesh, snapshot->diagram, box, snapshot->cellSites, snapshot->sites.size());
+
+   Voronoi::getEdges(snapshot->mesh, box, edges, voronoiWorkspace.shared);
+   edges.push_back({{box.minX, box.minY}, {box.maxX, box.minY}});
+   edges.push_back({{box.maxX, box.minY}, {box.maxX, box.maxY}});
+   edges.push_back({{box.maxX, box.maxY}, {box.minX, box.maxY}});
+   edges.push_back({{box.minX, box.maxY}, {box.minX, box.minY}});
+   snapshot->edgeGrid.build(edges, box);
+
+   snapshot->sitesPath.clear();
+   snapshot->cellsPath.clear();
+   snapshot->trianglesPath.clear();
+
+   for (const auto &site : snapshot->sites)
+      snapshot->sitesPath.addEllipse(static_cast<float>(site.x) - 2.f, static_cast<float>(site.y) - 2.f, 4.f, 4.f);
+
+   const auto &diagram = snapshot->diagram;
+   for (size_t c = 0; c < diagram.numCells(); ++c)
+   {
+      const int n = diagram.cellSize(c);
+      if (n < 2)
+         continue;
+
+      const auto &first = diagram.cellVertex(c, 0);
+      snapshot->cellsPath.startNewSubPath(static_cast<float>(first.x), static_cast<float>(first.y));
+      for (int k = 1; k < n; ++k)
+      {
+         const auto &vertex = diagram.cellVertex(c, k);
+         snapshot->cellsPath.lineTo(static_cast<float>(vertex.x), static_cast<float>(vertex.y));
+      }
+      snapshot->cellsPath.closeSubPath();
+   }
+
+   // Each interior edge is shared by two half-edges, draw it once
+   const auto &mesh = snapshot->mesh;
+   for (size_t e = 0; e < mesh.triangles.size(); ++e)
+   {
+      int twin = mesh.halfedges[e];
+      if (twin != GeoUtils::NO_HALFEDGE && twin < static_cast<int>(e))
+         continue;
+
+      const auto &u = mesh.points[mesh.triangles[e]];
+      const auto &v = mesh.points[mesh.triangles[GeoUtils::nextHalfedge(static_cast<int>(e))]];
+      snapshot->trianglesPath.startNewSubPath(static_cast<float>(u.getX()), static_cast<float>(u.getY()));
+      snapshot->trianglesPath.lineTo(static_cast<float>(v.getX()), static_cast<float>(v.getY()));
+   }
+
+   return snapshot;
+}
+
+// A pooled snapshot only the pool references has left both mailboxes and every reader, and
+// nothing can reach it again, so the worker may overwrite it
+GeometrySnapshot::Ptr GeometryWorker::takeSpareSnapshot()
+{
+   {
+      const juce::ScopedLock lock(releaseLock);
+      for (auto it = releasePool.begin(); it != releasePool.end(); ++it)
+      {
+         if ((*it)->getReferenceCount() == 1)
+         {
+            GeometrySnapshot::Ptr spare = *it;
+            releasePool.erase(it);
+            return spare;
+         }
+      }
+   }
+   return new GeometrySnapshot();
+}
+
+void GeometryWorker::publish(const GeometrySnapshot::Ptr &snapshot)
+{
+   {
+      const juce::ScopedLock lock(releaseLock);
+      releasePool.push_back(snapshot);
+   }
+   post(editorMailbox, snapshot.get());
+   post(audioMailbox, snapshot.get());
+}
+
+void GeometryWorker::post(std::atomic<GeometrySnapshot *> &mailbox, GeometrySnapshot *snapshot)
+{
+   if (snapshot != nullptr)
+      snapshot->incReferenceCount();
+
+   // A snapshot the reader never collected is simply dropped
+   if (auto *unread = mailbox.exchange(snapshot, std::memory_order_acq_rel))
+      unread->decReferenceCount();
+}
+
+bool GeometryWorker::pull(std::atomic<GeometrySnapshot *> &mailbox, GeometrySnapshot::Ptr &latest)
+{
+   auto *incoming = mailbox.exchange(nullptr, std::memory_order_acq_rel);
+   if (incoming == nullptr)
+      return false;
+
+   // The release pool still holds both snapshots, so neither reference change can free one here
+   latest = incoming;
+   incoming->decReferenceCount();
+   return true;
+}
+
+void GeometryWorker::timerCallback()
+{
+   const juce::ScopedLock lock(releaseLock);
+
+   // The pool is in publishing order; the newest unreferenced snapshot stays as the spare
+   auto spare = std::find_if(releasePool.rbegin(), releasePool.rend(), [](const GeometrySnapshot::Ptr &snapshot)
+                             { return snapshot->getReferenceCount() <= 1; });
+   if (spare == releasePool.rend())
+      return;
+
+   const GeometrySnapshot *keep = spare->get();
+   releasePool.erase(std::remove_if(releasePool.begin(), releasePool.end(), [keep](const GeometrySnapshot::Ptr &snapshot)
+                                    { return snapshot.get() != keep && snapshot->getReferenceCount() <= 1; }),
+                     releasePool.end());
+}
@@ -0,0 +1,68 @@
+#include "geometry/Mesh.h"
+#include <algorithm>
+#include <numeric>
+
+namespace GeoUtils
+{
+   std::vector<Triangle> Mesh::toTriangles() const
+   {
+      std::vector<Triangle> tris;
+      tris.reserve(numTriangles());
+      for (size_t t = 0; t < numTriangles(); ++t)
+         tris.push_back(getTriangle(t));
+      return tris;
+   }
+
+   Mesh Mesh::fromTriangles(const std::vector<Triangle> &tris)
+   {
+      Mesh mesh;
+      if (tris.empty())
+         return mesh;
+
+      std::vector<Point> corners;
+      corners.reserve(tris.size() * 3);
+      for (const auto &t : tris)
+      {
+         double area = (t.b.x - t.a.x) * (t.c.y - t.a.y) - (t.b.y - t.a.y) * (t.c.x - t.a.x);
+         corners.push_back(t.a);
+         corners.push_back(area < 0.0 ? t.c : t.b);
+         corners.push_back(area < 0.0 ? t.b : t.c);
+      }
+
+      std::vector<int> order(corners.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::sort(order.begin(), order.end(), [&](int a, int b)
+                { return PointComparator()(corners[a], corners[b]); });
+
+      mesh.triangles.resize(corners.size());
+      for (size_t i = 0; i < order.size(); ++i)
+      {
+         if (i == 0 || corners[order[i]] != corners[order[i - 1]])
+            mesh.points.push_back(corners[order[i]]);
+         mesh.triangles[order[i]] = static_cast<int>(mesh.points.size()) - 1;
+      }
+
+      // Twins share the same vertex pair; pair them up by sorting on the undirected key
+      std::vector<int> edges(corners.size());
+      std::iota(edges.begin(), edges.end(), 0);
+      auto key = [&](int e)
+      {
+         int u = mesh.triangles[e], v = mesh.triangles[nextHalfedge(e)];
+         return std::make_pair(std::min(u, v), std::max(u, v));
+      };
+      std::sort(edges.begin(), edges.end(), [&](int a, int b)
+                { return key(a) < key(b); });
+
+      mesh.halfedges.assign(corners.size(), NO_HALFEDGE);
+      for (size_t i = 0; i + 1 < edges.size(); ++i)
+      {
+         if (key(edges[i]) == key(edges[i + 1]))
+         {
+            mesh.halfedges[edges[i]] = edges[i + 1];
+            mesh.halfedges[edges[i + 1]] = edges[i];
+            ++i;
+         }
+      }
+      return mesh;
+   }
+}
@@ -0,0 +1,281 @@
+#include "geometry/Predicates.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// This file must be compiled without floating-point contraction (see plugin/CMakeLists.txt):
+// the error-free transformations below rely on every operation being rounded on its own.
+
+namespace
+{
+   constexpr double epsilon = std::numeric_limits<double>::epsilon() / 2.0;
+   constexpr double orientBound = (3.0 + 16.0 * epsilon) * epsilon;
+   constexpr double incircleBound = (10.0 + 96.0 * epsilon) * epsilon;
+
+   // Expansions are arrays of non-overlapping components in increasing order of magnitude
+   // whose exact sum is the represented value; the last component carries its sign.
+
+   // a + b = x + y exactly, requires |a| >= |b|
+   inline void fastTwoSum(double a, double b, double &x, double &y)
+   {
+      x = a + b;
+      y = b - (x - a);
+   }
+
+   // a + b = x + y exactly
+   inline void twoSum(double a, double b, double &x, double &y)
+   {
+      x = a + b;
+      double bvirt = x - a;
+      double avirt = x - bvirt;
+      y = (a - avirt) + (b - bvirt);
+   }
+
+   // a - b = x + y exactly
+   inline void twoDiff(double a, double b, double &x, double &y)
+   {
+      x = a - b;
+      double bvirt = a - x;
+      double avirt = x + bvirt;
+      y = (a - avirt) + (bvirt - b);
+   }
+
+   // a * b = x + y exactly
+   inline void twoProduct(double a, double b, double &x, double &y)
+   {
+      x = a * b;
+      y = std::fma(a, b, -x);
+   }
+
+   // h = e + f with zero components removed; h must hold elen + flen components
+   int sumExpansions(const double *e, int elen, const double *f, int flen, double *h)
+   {
+      int ei = 0, fi = 0, hi = 0;
+      double q, qnew, hh;
+
+      auto takeSmaller = [&]()
+      {
+         double en = e[ei], fn = f[fi];
+         if ((fn > en) == (fn > -en))
+         {
+            ++ei;
+            return en;
+         }
+         ++fi;
+         return fn;
+      };
+
+      q = takeSmaller();
+      if (ei < elen && fi < flen)
+      {
+         fastTwoSum(takeSmaller(), q, qnew, hh);
+         q = qnew;
+         if (hh != 0.0)
+            h[hi++] = hh;
+
+         while (ei < elen && fi < flen)
+         {
+            twoSum(q, takeSmaller(), qnew, hh);
+            q = qnew;
+            if (hh != 0.0)
+               h[hi++] = hh;
+         }
+      }
+      while (ei < elen)
+      {
+         twoSum(q, e[ei++], qnew, hh);
+         q = qnew;
+         if (hh != 0.0)
+            h[hi++] = hh;
+      }
+      while (fi < flen)
+      {
+         twoSum(q, f[fi++], qnew, hh);
+         q = qnew;
+         if (hh != 0.0)
+            h[hi++] = hh;
+      }
+      if (q != 0.0 || hi == 0)
+         h[hi++] = q;
+      return hi;
+   }
+
+   // h = e * b with zero components removed; h must hold 2 * elen components
+   int scaleExpansion(const double *e, int elen, double b, double *h)
+   {
+      int hi = 0;
+      double q, hh;
+      twoProduct(e[0], b, q, hh);
+      if (hh != 0.0)
+         h[hi++] = hh;
+
+      for (int i = 1; i < elen; ++i)
+      {
+         double product1, product0, sum;
+         twoProduct(e[i], b, product1, product0);
+         twoSum(q, product0, sum, hh);
+         if (hh != 0.0)
+            h[hi++] = hh;
+         fastTwoSum(product1, sum, q, hh);
+         if (hh != 0.0)
+            h[hi++] = hh;
+      }
+      if (q != 0.0 || hi == 0)
+         h[hi++] = q;
+      return hi;
+   }
+
+   // h = e * f; elen <= 16 and h must hold 2 * elen * flen <= 512 components
+   int multiplyExpansions(const double *e, int elen, const double *f, int flen, double *h)
+   {
+      double scaled[32];
+      double partial[512];
+
+      int hlen = scaleExpansion(e, elen, f[0], h);
+      for (int i = 1; i < flen; ++i)
+      {
+         int slen = scaleExpansion(e, elen, f[i], scaled);
+         std::copy(h, h + hlen, partial);
+         hlen = sumExpansions(partial, hlen, scaled, slen, h);
+      }
+      return hlen;
+   }
+
+   void negate(double *e, int elen)
+   {
+      for (int i = 0; i < elen; ++i)
+         e[i] = -e[i];
+   }
+
+   double orient2dExact(const GeoUtils::Point &a, const GeoUtils::Point &b, const GeoUtils::Point &c)
+   {
+      // ax*by - ax*cy - ay*bx + ay*cx + bx*cy - by*cx with every product split into two exact terms
+      const double factors[6][2] = {{a.x, b.y}, {-a.x, c.y}, {-a.y, b.x}, {a.y, c.x}, {b.x, c.y}, {-b.y, c.x}};
+
+      double sum[2][12];
+      int len = 0;
+      for (int i = 0; i < 6; ++i)
+      {
+         double product[2];
+         twoProduct(factors[i][0], factors[i][1], product[1], product[0]);
+         if (i == 0)
+         {
+            std::copy(product, product + 2, sum[0]);
+            len = 2;
+            continue;
+         }
+         len = sumExpansions(sum[(i + 1) % 2], len, product, 2, sum[i % 2]);
+      }
+      return sum[1][len - 1];
+   }
+
+   double incircleExact(const GeoUtils::Point &a, const GeoUtils::Point &b, const GeoUtils::Point &c, const GeoUtils::Point &d)
+   {
+      // The translated coordinates are exact as two-component expansions
+      double adx[2], ady[2], bdx[2], bdy[2], cdx[2], cdy[2];
+      twoDiff(a.x, d.x, adx[1], adx[0]);
+      twoDiff(a.y, d.y, ady[1], ady[0]);
+      twoDiff(b.x, d.x, bdx[1], bdx[0]);
+      twoDiff(b.y, d.y, bdy[1], bdy[0]);
+      twoDiff(c.x, d.x, cdx[1], cdx[0]);
+      twoDiff(c.y, d.y, cdy[1], cdy[0]);
+
+      // ux * vy - vx * uy, at most 16 components
+      auto cross = [](const double *ux, const double *uy, const double *vx, const double *vy, double *out)
+      {
+         double left[8], right[8];
+         int llen = multiplyExpansions(ux, 2, vy, 2, left);
+         int rlen = multiplyExpansions(vx, 2, uy, 2, right);
+         negate(right, rlen);
+         return sumExpansions(left, llen, right, rlen, out);
+      };
+
+      // ux * ux + uy * uy, at most 16 components
+      auto lift = [](const double *ux, const double *uy, double *out)
+      {
+         double xx[8], yy[8];
+         int xlen = multiplyExpansions(ux, 2, ux, 2, xx);
+         int ylen = multiplyExpansions(uy, 2, uy, 2, yy);
+         return sumExpansions(xx, xlen, yy, ylen, out);
+      };
+
+      auto term = [&](const double *ux, const double *uy, const double *vx, const double *vy,
+                      const double *wx, const double *wy, double *out)
+      {
+         double l[16], cr[16];
+         int llen = lift(ux, uy, l);
+         int clen = cross(vx, vy, wx, wy, cr);
+         return multiplyExpansions(l, llen, cr, clen, out);
+      };
+
+      double aterm[512], bterm[512], cterm[512];
+      int alen = term(adx, ady, bdx, bdy, cdx, cdy, aterm);
+      int blen = term(bdx, bdy, cdx, cdy, adx, ady, bterm);
+      int clen = term(cdx, cdy, adx, ady, bdx, bdy, cterm);
+
+      double ab[1024], det[1536];
+      int ablen = sumExpansions(aterm, alen, bterm, blen, ab);
+      int len = sumExpansions(ab, ablen, cterm, clen, det);
+      return det[len - 1];
+   }
+}
+
+namespace GeoUtils
+{
+   double orient2d(const Point &a, const Point &b, const Point &c)
+   {
+      double detleft = (a.x - c.x) * (b.y - c.y);
+      double detright = (a.y - c.y) * (b.x - c.x);
+      double det = detleft - detright;
+
+      double detsum;
+      if (detleft > 0.0)
+      {
+         if (detright <= 0.0)
+            return det;
+         detsum = detleft + detright;
+      }
+      else if (detleft < 0.0)
+      {
+         if (detright >= 0.0)
+            return det;
+         detsum = -detleft - detright;
+      }
+      else
+      {
+         return det;
+      }
+
+      double errbound = orientBound * detsum;
+      if (det >= errbound || -det >= errbound)
+         return det;
+
+      return orient2dExact(a, b, c);
+   }
+
+   double incircle(const Point &a, const Point &b, const Point &c, const Point &d)
+   {
+      double adx = a.x - d.x, ady = a.y - d.y;
+      double bdx = b.x - d.x, bdy = b.y - d.y;
+      double cdx = c.x - d.x, cdy = c.y - d.y;
+
+      double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+      double cdxady = cdx * ady, adxcdy = adx * cdy;
+      double adxbdy = adx * bdy, bdxady = bdx * ady;
+
+      double alift = adx * adx + ady * ady;
+      double blift = bdx * bdx + bdy * bdy;
+      double clift = cdx * cdx + cdy * cdy;
+
+      double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+
+      double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * alift +
+                         (std::abs(cdxady) + std::abs(adxcdy)) * blift +
+                         (std::abs(adxbdy) + std::abs(bdxady)) * clift;
+      double errbound = incircleBound * permanent;
+      if (det > errbound || -det > errbound)
+         return det;
+
+      return incircleExact(a, b, c, d);
+   }
+}
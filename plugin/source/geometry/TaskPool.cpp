@@ -0,0 +1,164 @@
+#include "geometry/TaskPool.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+   // Set while a thread runs tasks, so nested parallelFor calls stay on that thread
+   thread_local bool runningTask = false;
+}
+
+namespace GeoUtils
+{
+   TaskPool::TaskPool(int numThreads)
+   {
+      if (numThreads <= 0)
+         numThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+
+      shares = std::make_unique<Share[]>(static_cast<size_t>(numThreads));
+      workers.reserve(static_cast<size_t>(numThreads - 1));
+      for (int i = 1; i < numThreads; ++i)
+         workers.emplace_back([this, i]
+                              { workerLoop(i); });
+   }
+
+   TaskPool::~TaskPool()
+   {
+      {
+         std::lock_guard<std::mutex> lock(stateLock);
+         quitting = true;
+      }
+      wake.notify_all();
+      for (auto &worker : workers)
+         worker.join();
+   }
+
+   void TaskPool::parallelFor(int count, TaskRef task)
+   {
+      if (count <= 0)
+         return;
+
+      if (workers.empty() || count == 1 || runningTask)
+      {
+         for (int i = 0; i < count; ++i)
+            task(i);
+         return;
+      }
+
+      std::lock_guard<std::mutex> jobGuard(jobLock);
+      const int numThreads = getNumThreads();
+      for (int i = 0; i < numThreads; ++i)
+      {
+         std::lock_guard<std::mutex> lock(shares[i].lock);
+         shares[i].next = static_cast<int>(static_cast<int64_t>(count) * i / numThreads);
+         shares[i].end = static_cast<int>(static_cast<int64_t>(count) * (i + 1) / numThreads);
+      }
+
+      {
+         std::lock_guard<std::mutex> lock(stateLock);
+         job = &task;
+         busyWorkers = static_cast<int>(workers.size());
+         ++generation;
+      }
+      wake.notify_all();
+
+      runShare(0);
+
+      std::unique_lock<std::mutex> lock(stateLock);
+      finished.wait(lock, [this]
+                    { return busyWorkers == 0; });
+      job = nullptr;
+   }
+
+   void TaskPool::workerLoop(int index)
+   {
+      unsigned seen = 0;
+      for (;;)
+      {
+         {
+            std::unique_lock<std::mutex> lock(stateLock);
+            wake.wait(lock, [&]
+                      { return quitting || generation != seen; });
+            if (quitting)
+               return;
+            seen = generation;
+         }
+
+         runShare(index);
+
+         std::lock_guard<std::mutex> lock(stateLock);
+         if (--busyWorkers == 0)
+            finished.notify_one();
+      }
+   }
+
+   void TaskPool::runShare(int index)
+   {
+      runningTask = true;
+      int task;
+      while (take(index, task))
+         (*job)(task);
+      runningTask = false;
+   }
+
+   // Next index from this thread's own share, or from the upper half of the largest other one
+   bool TaskPool::take(int index, int &task)
+   {
+      {
+         std::lock_guard<std::mutex> lock(shares[index].lock);
+         if (shares[index].next < shares[index].end)
+         {
+            task = shares[index].next++;
+            return true;
+         }
+      }
+
+      const int numThreads = getNumThreads();
+      for (;;)
+      {
+         int victim = -1, most = 0;
+         for (int i = 0; i < numThreads; ++i)
+         {
+            if (i == index)
+               continue;
+            std::lock_guard<std::mutex> lock(shares[i].lock);
+            if (shares[i].end - shares[i].next > most)
+            {
+               most = shares[i].end - shares[i].next;
+               victim = i;
+            }
+         }
+         if (victim < 0)
+            return false;
+
+         int begin, end;
+         {
+            std::lock_guard<std::mutex> lock(shares[victim].lock);
+            const int remaining = shares[victim].end - shares[victim].next;
+            if (remaining <= 0)
+               continue; // drained while we looked, look again
+            end = shares[victim].end;
+            begin = end - (remaining + 1) / 2;
+            shares[victim].end = begin;
+         }
+
+         // Our own share is empty, so nobody steals from it until it is refilled here
+         std::lock_guard<std::mutex> lock(shares[index].lock);
+         shares[index].next = begin + 1;
+         shares[index].end = end;
+         task = begin;
+         return true;
+      }
+   }
+
+   void parallelFor(TaskPool *pool, int count, TaskRef task)
+   {
+      if (pool != nullptr)
+      {
+         pool->parallelFor(count, task);
+         return;
+      }
+      for (int i = 0; i < count; ++i)
+         task(i);
+   }
+}
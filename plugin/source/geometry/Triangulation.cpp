@@ -0,0 +1,1353 @@
+#include "geometry/Triangulation.h"
+#include "geometry/Predicates.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VORONOISE_SSE2 1
+#endif
+
+namespace
+{
+   constexpr double epsilon = std::numeric_limits<double>::epsilon() / 2.0;
+   constexpr double unknownError = std::numeric_limits<double>::infinity();
+
+   struct CircumcircleCache
+   {
+      const double *x, *y, *r2, *err, *errR;
+   };
+
+   // +1 if p is certainly inside the cached circumcircle of t, -1 if certainly outside, 0 if
+   // the rounding error of the cache could change the answer. With an infinite error the
+   // margin is infinite or NaN, and both comparisons fail.
+   inline int8_t classify(const CircumcircleCache &cache, int t, const GeoUtils::Point &p)
+   {
+      double dx = p.x - cache.x[t], dy = p.y - cache.y[t];
+      double d2 = dx * dx + dy * dy;
+      double g = d2 - cache.r2[t];
+      double margin = cache.err[t] * (std::abs(dx) + std::abs(dy)) + cache.errR[t] + 8.0 * epsilon * (d2 + cache.r2[t]);
+      if (g < -margin)
+         return 1;
+      if (g > margin)
+         return -1;
+      return 0;
+   }
+
+   // classify() over a batch of triangles, two at a time where SSE2 is available
+   void classifyBatch(const CircumcircleCache &cache, const int *tris, size_t count, const GeoUtils::Point &p, int8_t *out)
+   {
+      size_t i = 0;
+#if VORONOISE_SSE2
+      const __m128d px = _mm_set1_pd(p.x), py = _mm_set1_pd(p.y);
+      const __m128d roundoff = _mm_set1_pd(8.0 * epsilon);
+      const __m128d signBit = _mm_set1_pd(-0.0);
+      for (; i + 2 <= count; i += 2)
+      {
+         const int t0 = tris[i], t1 = tris[i + 1];
+         __m128d dx = _mm_sub_pd(px, _mm_set_pd(cache.x[t1], cache.x[t0]));
+         __m128d dy = _mm_sub_pd(py, _mm_set_pd(cache.y[t1], cache.y[t0]));
+         __m128d r2 = _mm_set_pd(cache.r2[t1], cache.r2[t0]);
+         __m128d d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+         __m128d g = _mm_sub_pd(d2, r2);
+
+         __m128d l1 = _mm_add_pd(_mm_andnot_pd(signBit, dx), _mm_andnot_pd(signBit, dy));
+         __m128d margin = _mm_add_pd(_mm_mul_pd(_mm_set_pd(cache.err[t1], cache.err[t0]), l1), _mm_set_pd(cache.errR[t1], cache.errR[t0]));
+         margin = _mm_add_pd(margin, _mm_mul_pd(roundoff, _mm_add_pd(d2, r2)));
+
+         int inside = _mm_movemask_pd(_mm_cmplt_pd(g, _mm_xor_pd(margin, signBit)));
+         int outside = _mm_movemask_pd(_mm_cmpgt_pd(g, margin));
+         out[i] = (inside & 1) ? 1 : (outside & 1) ? -1 : 0;
+         out[i + 1] = (inside & 2) ? 1 : (outside & 2) ? -1 : 0;
+      }
+#endif
+      for (; i < count; ++i)
+         out[i] = classify(cache, tris[i], p);
+   }
+
+   uint32_t hilbertIndex(uint32_t x, uint32_t y)
+   {
+      uint32_t d = 0;
+      for (uint32_t s = 1u << 15; s > 0; s >>= 1)
+      {
+         uint32_t rx = (x & s) > 0;
+         uint32_t ry = (y & s) > 0;
+         d += s * s * ((3 * rx) ^ ry);
+         if (ry == 0)
+         {
+            if (rx == 1)
+            {
+               x = s - 1 - x;
+               y = s - 1 - y;
+            }
+            std::swap(x, y);
+         }
+      }
+      return d;
+   }
+
+   // Biased randomized insertion order: shuffled rounds of doubling size, each sorted along
+   // a Hilbert curve so consecutive points are close and the walk from the last insertion
+   // stays short. The shuffle is seeded so the result is reproducible.
+   void sortForInsertion(const std::vector<GeoUtils::Point> &points, std::pmr::vector<int> &order)
+   {
+      const int n = static_cast<int>(order.size());
+      if (n == 0)
+         return;
+
+      std::mt19937 rng(0x5eed);
+      for (int i = n - 1; i > 0; --i)
+         std::swap(order[i], order[rng() % static_cast<uint32_t>(i + 1)]);
+
+      double minX = points[order[0]].x, maxX = minX;
+      double minY = points[order[0]].y, maxY = minY;
+      for (int i : order)
+      {
+         minX = std::min(minX, points[i].x);
+         maxX = std::max(maxX, points[i].x);
+         minY = std::min(minY, points[i].y);
+         maxY = std::max(maxY, points[i].y);
+      }
+      double scale = 65535.0 / std::max({maxX - minX, maxY - minY, std::numeric_limits<double>::min()});
+
+      auto key = [&](int i)
+      {
+         auto qx = static_cast<uint32_t>((points[i].x - minX) * scale);
+         auto qy = static_cast<uint32_t>((points[i].y - minY) * scale);
+         return hilbertIndex(qx, qy);
+      };
+      std::pmr::vector<std::pair<uint32_t, int>> keyed(order.size(), order.get_allocator());
+      for (int i = 0; i < n; ++i)
+         keyed[i] = {key(order[i]), order[i]};
+
+      int end = n;
+      while (end > 0)
+      {
+         int begin = end > 64 ? end / 2 : 0;
+         std::sort(keyed.begin() + begin, keyed.begin() + end);
+         end = begin;
+      }
+
+      for (int i = 0; i < n; ++i)
+         order[i] = keyed[i].second;
+   }
+
+   // Sites per slab of a split build. Slabs are kept at least 32 sites wide on a square
+   // layout; thinner ones spend more on stitching than they save.
+   constexpr size_t slabSites = 8192;
+
+   size_t numSlabs(size_t numSites)
+   {
+      const auto maxSlabs = static_cast<size_t>(std::sqrt(static_cast<double>(numSites)) / 32.0);
+      return std::max<size_t>(1, std::min(numSites / slabSites, maxSlabs));
+   }
+}
+
+namespace Delaunay
+{
+   Triangulation::Triangulation(const std::vector<GeoUtils::Point> &points, GeoUtils::TaskPool *pool)
+   {
+      build(points, pool);
+   }
+
+   void Triangulation::build(const std::vector<GeoUtils::Point> &points, GeoUtils::TaskPool *pool)
+   {
+      clear();
+      positions = points;
+      buildAll(pool);
+   }
+
+   // Makes every position a live site and triangulates them from scratch
+   void Triangulation::buildAll(GeoUtils::TaskPool *pool)
+   {
+      live.assign(positions.size(), 1);
+      vertexEdges.assign(positions.size(), NONE);
+      siteStamps.assign(positions.size(), 0);
+      numLive = positions.size();
+
+      beginEdit();
+      rebuild(pool);
+   }
+
+   void Triangulation::clear()
+   {
+      positions.clear();
+      live.clear();
+      vertexEdges.clear();
+      freeSites.clear();
+      hiddenSites.clear();
+      numLive = 0;
+
+      triangles.clear();
+      halfedges.clear();
+      freeTriangles.clear();
+      triangleStamps.clear();
+      circumX.clear();
+      circumY.clear();
+      circumR2.clear();
+      circumErr.clear();
+      circumErrR.clear();
+      numFinite = 0;
+      lastTriangle = NONE;
+
+      changedSites.clear();
+      siteStamps.clear();
+   }
+
+   bool Triangulation::isGhost(int t) const
+   {
+      return triangles[3 * t] == GHOST || triangles[3 * t + 1] == GHOST || triangles[3 * t + 2] == GHOST;
+   }
+
+   int Triangulation::allocateSite(const GeoUtils::Point &p)
+   {
+      int site;
+      if (!freeSites.empty())
+      {
+         site = freeSites.back();
+         freeSites.pop_back();
+         positions[site] = p;
+      }
+      else
+      {
+         site = static_cast<int>(positions.size());
+         positions.push_back(p);
+         live.push_back(0);
+         vertexEdges.push_back(NONE);
+         siteStamps.push_back(0);
+      }
+      live[site] = 1;
+      vertexEdges[site] = NONE;
+      ++numLive;
+      return site;
+   }
+
+   int Triangulation::addTriangle(int a, int b, int c)
+   {
+      int t;
+      if (!freeTriangles.empty())
+      {
+         t = freeTriangles.back();
+         freeTriangles.pop_back();
+      }
+      else
+      {
+         t = static_cast<int>(triangles.size() / 3);
+         triangles.resize(triangles.size() + 3);
+         halfedges.resize(halfedges.size() + 3, NONE);
+         triangleStamps.push_back(0);
+         circumX.push_back(0.0);
+         circumY.push_back(0.0);
+         circumR2.push_back(0.0);
+         circumErr.push_back(unknownError);
+         circumErrR.push_back(unknownError);
+      }
+      setTriangle(t, a, b, c);
+      if (a != GHOST && b != GHOST && c != GHOST)
+      {
+         ++numFinite;
+         lastTriangle = t;
+      }
+      return t;
+   }
+
+   void Triangulation::setTriangle(int t, int a, int b, int c)
+   {
+      const int corners[3] = {a, b, c};
+      for (int k = 0; k < 3; ++k)
+      {
+         triangles[3 * t + k] = corners[k];
+         if (corners[k] != GHOST)
+         {
+            vertexEdges[corners[k]] = 3 * t + k;
+            markChanged(corners[k]);
+         }
+      }
+      updateCircumcircle(t);
+   }
+
+   void Triangulation::updateCircumcircle(int t)
+   {
+      const int a = triangles[3 * t], b = triangles[3 * t + 1], c = triangles[3 * t + 2];
+      circumErr[t] = circumErrR[t] = unknownError;
+      if (a == GHOST || b == GHOST || c == GHOST)
+         return;
+
+      // Centre relative to a; the bounds below over-estimate the forward error of each step
+      const auto &pa = positions[a];
+      double bx = positions[b].x - pa.x, by = positions[b].y - pa.y;
+      double cx = positions[c].x - pa.x, cy = positions[c].y - pa.y;
+      double bl = bx * bx + by * by, cl = cx * cx + cy * cy;
+
+      double d = 2.0 * (bx * cy - by * cx);
+      double inv = 1.0 / d;
+      double ux = (cy * bl - by * cl) * inv;
+      double uy = (bx * cl - cx * bl) * inv;
+      circumX[t] = pa.x + ux;
+      circumY[t] = pa.y + uy;
+      circumR2[t] = (pa.x - circumX[t]) * (pa.x - circumX[t]) + (pa.y - circumY[t]) * (pa.y - circumY[t]);
+
+      double dErr = 24.0 * epsilon * (std::abs(bx * cy) + std::abs(by * cx));
+      if (!(std::abs(d) > 2.0 * dErr) || !std::isfinite(circumR2[t]))
+         return;
+
+      double nxErr = 16.0 * epsilon * (std::abs(cy) * bl + std::abs(by) * cl);
+      double nyErr = 16.0 * epsilon * (std::abs(bx) * cl + std::abs(cx) * bl);
+      double centreErr = 2.0 * (nxErr + nyErr + (std::abs(ux) + std::abs(uy)) * dErr) * std::abs(inv) +
+                         4.0 * epsilon * (std::abs(ux) + std::abs(uy) + std::abs(circumX[t]) + std::abs(circumY[t]));
+
+      // Moving the centre by e changes |p - c|^2 - |a - c|^2 by at most 2e|p - a|, and
+      // |p - a| <= |p - c| + |u|, both taken in the L1 norm
+      circumErr[t] = 2.0 * centreErr;
+      circumErrR[t] = 2.0 * centreErr * (std::abs(ux) + std::abs(uy));
+   }
+
+   void Triangulation::freeTriangle(int t)
+   {
+      if (!isGhost(t))
+         --numFinite;
+      halfedges[3 * t] = halfedges[3 * t + 1] = halfedges[3 * t + 2] = NONE;
+      freeTriangles.push_back(t);
+   }
+
+   void Triangulation::link(int e, int twin)
+   {
+      halfedges[e] = twin;
+      halfedges[twin] = e;
+   }
+
+   void Triangulation::beginEdit()
+   {
+      ++editEpoch;
+      changedSites.clear();
+   }
+
+   void Triangulation::markChanged(int site)
+   {
+      if (siteStamps[site] != editEpoch)
+      {
+         siteStamps[site] = editEpoch;
+         changedSites.push_back(site);
+      }
+   }
+
+   void Triangulation::clearMesh()
+   {
+      triangles.clear();
+      halfedges.clear();
+      freeTriangles.clear();
+      triangleStamps.clear();
+      circumX.clear();
+      circumY.clear();
+      circumR2.clear();
+      circumErr.clear();
+      circumErrR.clear();
+      numFinite = 0;
+      lastTriangle = NONE;
+   }
+
+   void Triangulation::rebuild(GeoUtils::TaskPool *pool)
+   {
+      clearMesh();
+      hiddenSites.clear();
+      scratch.reset();
+
+      std::pmr::vector<int> ids(scratch.resource());
+      ids.reserve(numLive);
+      for (int v = 0; v < static_cast<int>(positions.size()); ++v)
+      {
+         vertexEdges[v] = NONE;
+         if (live[v])
+         {
+            ids.push_back(v);
+            markChanged(v);
+         }
+      }
+
+      // Exact duplicates never enter the mesh; finding them by sorting is cheaper than a point
+      // location each. restoreHidden brings one back if the copy that was kept goes away.
+      // Ties go to the lower id, which is the one kept.
+      GeoUtils::PointComparator less;
+      std::sort(ids.begin(), ids.end(), [&](int i, int j)
+                { return less(positions[i], positions[j]) || (positions[i] == positions[j] && i < j); });
+      size_t unique = 0;
+      for (size_t i = 0; i < ids.size(); ++i)
+      {
+         if (unique > 0 && positions[ids[i]] == positions[ids[unique - 1]])
+            hiddenSites.push_back(ids[i]);
+         else
+            ids[unique++] = ids[i];
+      }
+      ids.resize(unique);
+
+      if (splitLargeBuilds && numSlabs(ids.size()) > 1 && buildSlabs(ids, pool))
+         return;
+
+      auto &order = ids;
+      sortForInsertion(positions, order);
+
+      // Seed with the first non-degenerate triangle in insertion order
+      size_t i2 = 2;
+      while (i2 < order.size() && GeoUtils::orient2d(positions[order[0]], positions[order[1]], positions[order[i2]]) == 0.0)
+         ++i2;
+      if (i2 >= order.size())
+      {
+         hiddenSites.insert(hiddenSites.end(), order.begin(), order.end());
+         return;
+      }
+
+      int a = order[0], b = order[1], c = order[i2];
+      if (GeoUtils::orient2d(positions[a], positions[b], positions[c]) < 0.0)
+         std::swap(b, c);
+      seed(a, b, c);
+
+      for (size_t i = 1; i < order.size(); ++i)
+      {
+         if (i != 1 && i != i2 && !insertVertex(order[i]))
+            hiddenSites.push_back(order[i]);
+      }
+   }
+
+   void Triangulation::seed(int a, int b, int c)
+   {
+      int g0 = addTriangle(b, a, GHOST);
+      int g1 = addTriangle(c, b, GHOST);
+      int g2 = addTriangle(a, c, GHOST);
+      int t = addTriangle(a, b, c);
+
+      link(3 * t, 3 * g0);
+      link(3 * t + 1, 3 * g1);
+      link(3 * t + 2, 3 * g2);
+
+      // ghost spokes: (x -> GHOST) twins (GHOST -> x)
+      link(3 * g0 + 1, 3 * g2 + 2);
+      link(3 * g1 + 1, 3 * g0 + 2);
+      link(3 * g2 + 1, 3 * g1 + 2);
+   }
+
+   // Triangulates contiguous runs of ids, which are sorted by x then y, as independent slabs
+   // and stitches them left to right. Returns false, with the mesh cleared, if a slab is
+   // degenerate or a seam cannot be closed, and the caller falls back to a single build.
+   bool Triangulation::buildSlabs(const std::pmr::vector<int> &ids, GeoUtils::TaskPool *pool)
+   {
+      const size_t count = numSlabs(ids.size());
+      std::pmr::vector<size_t> starts(count + 1, scratch.resource());
+      for (size_t k = 0; k <= count; ++k)
+         starts[k] = ids.size() * k / count;
+
+      while (slabs.size() < count)
+      {
+         slabs.push_back(std::make_unique<Triangulation>());
+         slabs.back()->splitLargeBuilds = false;
+      }
+      auto buildSlab = [&](int k)
+      {
+         auto &slab = *slabs[k];
+         slab.clear();
+         for (size_t i = starts[k]; i < starts[k + 1]; ++i)
+            slab.positions.push_back(positions[ids[i]]);
+         slab.buildAll(nullptr);
+      };
+      GeoUtils::parallelFor(pool, static_cast<int>(count), buildSlab);
+
+      std::pmr::vector<int> offsets(count + 1, 0, scratch.resource());
+      for (size_t k = 0; k < count; ++k)
+      {
+         if (slabs[k]->numFinite == 0 || !slabs[k]->hiddenSites.empty())
+            return false;
+         offsets[k + 1] = offsets[k] + static_cast<int>(slabs[k]->triangles.size() / 3);
+      }
+
+      // Concatenate the slabs with their sites mapped back to ids and their triangles shifted
+      const auto numSlots = static_cast<size_t>(offsets[count]);
+      triangles.resize(3 * numSlots);
+      halfedges.resize(3 * numSlots);
+      triangleStamps.assign(numSlots, 0);
+      circumX.resize(numSlots);
+      circumY.resize(numSlots);
+      circumR2.resize(numSlots);
+      circumErr.resize(numSlots);
+      circumErrR.resize(numSlots);
+
+      auto copySlab = [&](int k)
+      {
+         const auto &slab = *slabs[k];
+         const int *slabIds = ids.data() + starts[k];
+         const int shift = 3 * offsets[k];
+         for (size_t e = 0; e < slab.triangles.size(); ++e)
+         {
+            const int v = slab.triangles[e], twin = slab.halfedges[e];
+            triangles[shift + e] = v == GHOST ? GHOST : slabIds[v];
+            halfedges[shift + e] = twin == NONE ? NONE : twin + shift;
+         }
+         std::copy(slab.circumX.begin(), slab.circumX.end(), circumX.begin() + offsets[k]);
+         std::copy(slab.circumY.begin(), slab.circumY.end(), circumY.begin() + offsets[k]);
+         std::copy(slab.circumR2.begin(), slab.circumR2.end(), circumR2.begin() + offsets[k]);
+         std::copy(slab.circumErr.begin(), slab.circumErr.end(), circumErr.begin() + offsets[k]);
+         std::copy(slab.circumErrR.begin(), slab.circumErrR.end(), circumErrR.begin() + offsets[k]);
+         for (size_t v = 0; v < starts[k + 1] - starts[k]; ++v)
+            vertexEdges[slabIds[v]] = slab.vertexEdges[v] + shift;
+      };
+      GeoUtils::parallelFor(pool, static_cast<int>(count), copySlab);
+
+      for (size_t k = 0; k < count; ++k)
+      {
+         for (int t : slabs[k]->freeTriangles)
+            freeTriangles.push_back(t + offsets[k]);
+         numFinite += slabs[k]->numFinite;
+      }
+
+      for (size_t k = 1; k < count; ++k)
+      {
+         // The last site of a slab and the first of the next are extreme in x, so on both hulls
+         if (!stitch(ids[starts[k] - 1], ids[starts[k]]))
+         {
+            clearMesh();
+            for (int v : ids)
+               vertexEdges[v] = NONE;
+            return false;
+         }
+      }
+      return true;
+   }
+
+   // Ghost triangle of the hull edge leaving hull site v counter-clockwise
+   int Triangulation::hullGhost(int v) const
+   {
+      const int first = vertexEdges[v];
+      int e = first;
+      do
+      {
+         if (triangles[GeoUtils::nextHalfedge(e)] == GHOST)
+            return e / 3;
+         e = halfedges[GeoUtils::prevHalfedge(e)];
+      } while (e != first);
+      return NONE;
+   }
+
+   // Joins the mesh to the left of leftMax with the disjoint one to the right of rightMin.
+   // The gap between their hulls is closed with a zipper of triangles between the two facing
+   // chains, and flips then repair the triangles near the seam.
+   bool Triangulation::stitch(int leftMax, int rightMin)
+   {
+      // A ghost triangle stands for the counter-clockwise hull edge v -> w; side() is its
+      // half-edge w -> v, followed by v -> GHOST and GHOST -> w
+      auto side = [this](int g)
+      {
+         int k = 0;
+         while (triangles[3 * g + k] != GHOST)
+            ++k;
+         return 3 * g + (k + 1) % 3;
+      };
+      auto from = [&](int g)
+      { return triangles[GeoUtils::nextHalfedge(side(g))]; };
+      auto to = [&](int g)
+      { return triangles[side(g)]; };
+      auto nextGhost = [&](int g)
+      { return halfedges[GeoUtils::prevHalfedge(side(g))] / 3; };
+      auto prevGhost = [&](int g)
+      { return halfedges[GeoUtils::nextHalfedge(side(g))] / 3; };
+      auto orient = [this](int a, int b, int c)
+      { return GeoUtils::orient2d(positions[a], positions[b], positions[c]); };
+
+      const int leftStart = hullGhost(leftMax), rightStart = hullGhost(rightMin);
+      if (leftStart == NONE || rightStart == NONE)
+         return false;
+
+      // Lower common tangent l0 -> r0 with both hulls on its left; each site is tracked with the
+      // ghost of the hull edge leaving it
+      int l0 = leftMax, r0 = rightMin, gl0 = leftStart, gr0 = rightStart;
+      for (bool moved = true; moved;)
+      {
+         moved = false;
+         while (orient(l0, r0, from(prevGhost(gl0))) < 0.0)
+         {
+            gl0 = prevGhost(gl0);
+            l0 = from(gl0);
+            moved = true;
+         }
+         while (orient(l0, r0, to(gr0)) < 0.0)
+         {
+            r0 = to(gr0);
+            gr0 = nextGhost(gr0);
+            moved = true;
+         }
+      }
+
+      // Upper common tangent l1 -> r1 with both hulls on its right
+      int l1 = leftMax, r1 = rightMin, gl1 = leftStart, gr1 = rightStart;
+      for (bool moved = true; moved;)
+      {
+         moved = false;
+         while (orient(l1, r1, to(gl1)) > 0.0)
+         {
+            l1 = to(gl1);
+            gl1 = nextGhost(gl1);
+            moved = true;
+         }
+         while (orient(l1, r1, from(prevGhost(gr1))) > 0.0)
+         {
+            gr1 = prevGhost(gr1);
+            r1 = from(gr1);
+            moved = true;
+         }
+      }
+
+      // The chains l0 -> l1 and r1 -> r0 leave the hull; when both ends of a chain are the same
+      // site it is that whole hull
+      auto chainGhosts = [&](int g, int end)
+      {
+         std::pmr::vector<int> chain(scratch.resource());
+         do
+         {
+            chain.push_back(g);
+            g = nextGhost(g);
+         } while (from(g) != end && chain.size() <= triangles.size());
+         return chain;
+      };
+      const auto leftChain = chainGhosts(gl0, l1);
+      const auto rightChain = chainGhosts(gr1, r0);
+      const bool leftEnclosed = l0 == l1, rightEnclosed = r0 == r1;
+      if (leftEnclosed && rightEnclosed)
+         return false;
+
+      const int intoL0 = leftEnclosed ? NONE : prevGhost(gl0);
+      const int intoR1 = rightEnclosed ? NONE : prevGhost(gr1);
+
+      // Zip upwards from the lower tangent. Each step adds the triangle on the current base and
+      // the next site of one chain. The new diagonal has to miss the other hull, which it does
+      // when it leaves that hull's corner outside the corner's wedge; when both are valid, the
+      // one that keeps the new triangle Delaunay is taken.
+      flips.clear();
+      int l = l0, r = r0, gl = gl0, gr = gr0;
+      size_t leftLeft = leftChain.size(), rightLeft = rightChain.size();
+      int firstBase = NONE, base = NONE;
+      while (leftLeft > 0 || rightLeft > 0)
+      {
+         const int nextL = to(gl), prevL = from(prevGhost(gl));
+         const int gPrevR = prevGhost(gr);
+         const int nextR = from(gPrevR), prevR = to(gr);
+
+         bool useL = leftLeft > 0 && orient(l, r, nextL) > 0.0 && (orient(nextR, r, nextL) < 0.0 || orient(r, prevR, nextL) < 0.0);
+         bool useR = rightLeft > 0 && orient(l, r, nextR) > 0.0 && (orient(prevL, l, nextR) < 0.0 || orient(l, nextL, nextR) < 0.0);
+         if (useL && useR)
+            useL = GeoUtils::incircle(positions[l], positions[r], positions[nextL], positions[nextR]) <= 0.0;
+         else if (!useL && !useR)
+            return false;
+
+         int t, top;
+         if (useL)
+         {
+            const int twin = halfedges[side(gl)];
+            t = addTriangle(l, r, nextL);
+            link(3 * t + 2, twin);
+            top = 3 * t + 1;
+            l = nextL;
+            gl = nextGhost(gl);
+            --leftLeft;
+         }
+         else
+         {
+            const int twin = halfedges[side(gPrevR)];
+            t = addTriangle(l, r, nextR);
+            link(3 * t + 1, twin);
+            top = 3 * t + 2;
+            r = nextR;
+            gr = gPrevR;
+            --rightLeft;
+         }
+
+         if (base == NONE)
+            firstBase = 3 * t;
+         else
+            link(3 * t, base);
+         base = top;
+         for (int k = 0; k < 3; ++k)
+            flips.push_back(3 * t + k);
+      }
+
+      // Swap the ghosts of both chains for the two tangent edges
+      for (int g : leftChain)
+         freeTriangle(g);
+      for (int g : rightChain)
+         freeTriangle(g);
+
+      const int lower = addTriangle(r0, l0, GHOST);
+      const int upper = addTriangle(l1, r1, GHOST);
+      link(3 * lower, firstBase);
+      link(3 * upper, base);
+
+      // (v -> GHOST) of the hull edge leaving v twins (GHOST -> v) of the one arriving at v
+      auto joinAt = [&](int leaving, int arriving)
+      { link(GeoUtils::nextHalfedge(side(leaving)), GeoUtils::prevHalfedge(side(arriving))); };
+      joinAt(lower, leftEnclosed ? upper : intoL0);
+      joinAt(rightEnclosed ? upper : gr0, lower);
+      joinAt(upper, rightEnclosed ? lower : intoR1);
+      joinAt(leftEnclosed ? lower : gl1, upper);
+
+      legalize();
+      return true;
+   }
+
+   // Ghost triangles conflict with the points beyond their hull edge, finite ones with the
+   // points inside their circumcircle
+   bool Triangulation::conflicts(int t, const GeoUtils::Point &p) const
+   {
+      int v[3] = {triangles[3 * t], triangles[3 * t + 1], triangles[3 * t + 2]};
+      for (int i = 0; i < 3; ++i)
+      {
+         if (v[i] != GHOST)
+            continue;
+
+         // Ghost triangle: conflicts when p sees its hull edge from outside
+         const auto &u = positions[v[(i + 1) % 3]];
+         const auto &w = positions[v[(i + 2) % 3]];
+         double o = GeoUtils::orient2d(u, w, p);
+         if (o != 0.0)
+            return o > 0.0;
+
+         // On the hull line: conflicts when strictly inside the edge; comparing along whichever
+         // axis the edge spans keeps this exact
+         if (u.x != w.x)
+            return (u.x < p.x && p.x < w.x) || (w.x < p.x && p.x < u.x);
+         return (u.y < p.y && p.y < w.y) || (w.y < p.y && p.y < u.y);
+      }
+      return inCircumcircle(t, p);
+   }
+
+   bool Triangulation::inCircumcircle(int t, const GeoUtils::Point &p) const
+   {
+      int8_t side = classify({circumX.data(), circumY.data(), circumR2.data(), circumErr.data(), circumErrR.data()}, t, p);
+      if (side != 0)
+         return side > 0;
+
+      return GeoUtils::incircle(positions[triangles[3 * t]], positions[triangles[3 * t + 1]], positions[triangles[3 * t + 2]], p) > 0.0;
+   }
+
+   int Triangulation::startTriangle()
+   {
+      if (lastTriangle != NONE && isLiveTriangle(lastTriangle) && !isGhost(lastTriangle))
+         return lastTriangle;
+
+      for (int t = 0; t < static_cast<int>(triangles.size() / 3); ++t)
+      {
+         if (isLiveTriangle(t) && !isGhost(t))
+            return lastTriangle = t;
+      }
+      return NONE;
+   }
+
+   // Visibility walk from the previous edit; stops on the triangle containing p, or on the
+   // ghost triangle behind the hull edge that p sees.
+   int Triangulation::locate(const GeoUtils::Point &p)
+   {
+      int t = startTriangle();
+      size_t steps = 0;
+      const size_t maxSteps = triangles.size();
+      while (t != NONE && steps++ < maxSteps)
+      {
+         int next = NONE;
+         for (int k = 0; k < 3; ++k)
+         {
+            int e = 3 * t + static_cast<int>((steps + k) % 3);
+            if (GeoUtils::orient2d(positions[triangles[e]], positions[triangles[GeoUtils::nextHalfedge(e)]], p) < 0.0)
+            {
+               next = halfedges[e] / 3;
+               break;
+            }
+         }
+         if (next == NONE || isGhost(next))
+            return next == NONE ? t : next;
+         t = next;
+      }
+      return NONE;
+   }
+
+   int Triangulation::findConflict(const GeoUtils::Point &p)
+   {
+      int t = locate(p);
+      if (t != NONE && conflicts(t, p))
+         return t;
+
+      for (int k = 0; t != NONE && k < 3; ++k)
+      {
+         int vertex = triangles[3 * t + k];
+         if (vertex != GHOST && positions[vertex] == p)
+            return NONE; // coincides with an existing site
+      }
+
+      // Walk failed on badly rounded input, fall back to a scan
+      for (int s = 0; s < static_cast<int>(triangles.size() / 3); ++s)
+      {
+         if (isLiveTriangle(s) && conflicts(s, p))
+            return s;
+      }
+      return NONE;
+   }
+
+   bool Triangulation::insertVertex(int v)
+   {
+      const auto &p = positions[v];
+      int start = findConflict(p);
+      if (start == NONE)
+         return false;
+
+      // Grow the cavity across adjacency; every edge leading out of it is on its boundary
+      ++searchEpoch;
+      cavity.clear();
+      boundary.clear();
+      cavity.push_back(start);
+      triangleStamps[start] = searchEpoch;
+
+      const CircumcircleCache cache{circumX.data(), circumY.data(), circumR2.data(), circumErr.data(), circumErrR.data()};
+      for (size_t i = 0; i < cavity.size();)
+      {
+         // Everything across the edges of the triangles added in the last round is tested as
+         // one batch against the cache; only undecided and ghost triangles need conflicts()
+         candidateEdges.clear();
+         candidateTriangles.clear();
+         for (const size_t roundEnd = cavity.size(); i < roundEnd; ++i)
+         {
+            for (int k = 0; k < 3; ++k)
+            {
+               int e = 3 * cavity[i] + k;
+               int n = halfedges[e] / 3;
+               if (triangleStamps[n] != searchEpoch)
+               {
+                  candidateEdges.push_back(e);
+                  candidateTriangles.push_back(n);
+               }
+            }
+         }
+
+         candidateSides.resize(candidateTriangles.size());
+         classifyBatch(cache, candidateTriangles.data(), candidateTriangles.size(), p, candidateSides.data());
+
+         for (size_t j = 0; j < candidateEdges.size(); ++j)
+         {
+            int e = candidateEdges[j], n = candidateTriangles[j];
+            if (triangleStamps[n] == searchEpoch)
+               continue;
+            if (candidateSides[j] > 0 || (candidateSides[j] == 0 && conflicts(n, p)))
+            {
+               triangleStamps[n] = searchEpoch;
+               cavity.push_back(n);
+            }
+            else
+            {
+               boundary.push_back({triangles[e], triangles[GeoUtils::nextHalfedge(e)], halfedges[e]});
+            }
+         }
+      }
+
+      for (int t : cavity)
+         freeTriangle(t);
+
+      // Refill as a fan around p, keeping the twins across the cavity boundary
+      spokes.clear();
+      for (const auto &edge : boundary)
+      {
+         int t = addTriangle(edge.from, edge.to, v);
+         link(3 * t, edge.twin);
+         spokes.emplace_back(edge.from, 3 * t);
+      }
+      std::sort(spokes.begin(), spokes.end());
+
+      for (const auto &[from, e] : spokes)
+      {
+         int to = triangles[e + 1];
+         auto it = std::lower_bound(spokes.begin(), spokes.end(), std::make_pair(to, std::numeric_limits<int>::min()));
+         // (to -> p) twins (p -> to) in the fan triangle starting at to
+         link(e + 1, it->second + 2);
+      }
+      return true;
+   }
+
+   // Sites around v in counter-clockwise order, the twins of the link edges between them,
+   // and the triangles of the star in cavity
+   void Triangulation::collectStar(int v)
+   {
+      ring.clear();
+      ringTwins.clear();
+      cavity.clear();
+
+      const int first = vertexEdges[v];
+      int e = first;
+      do
+      {
+         int n = GeoUtils::nextHalfedge(e);
+         cavity.push_back(e / 3);
+         ring.push_back(triangles[n]);
+         ringTwins.push_back(halfedges[n]);
+         e = halfedges[GeoUtils::prevHalfedge(e)];
+      } while (e != first);
+   }
+
+   // Cuts ring[curr] off the hole polygon with the triangle (prev, curr, next)
+   int Triangulation::clipEar(int prev, int curr, int next)
+   {
+      int t = addTriangle(ring[prev], ring[curr], ring[next]);
+      link(3 * t, ringTwins[prev]);
+      link(3 * t + 1, ringTwins[curr]);
+      halfedges[3 * t + 2] = NONE;
+
+      ringTwins[prev] = 3 * t + 2;
+      ring.erase(ring.begin() + curr);
+      ringTwins.erase(ringTwins.begin() + curr);
+      return t;
+   }
+
+   // Removes v from the mesh and fills its star. The hole is ear-clipped and then made
+   // Delaunay again with edge flips. Returns true if the mesh had to be rebuilt because
+   // the remaining sites became degenerate.
+   bool Triangulation::unlinkVertex(int v)
+   {
+      collectStar(v);
+      for (int t : cavity)
+         freeTriangle(t);
+      vertexEdges[v] = NONE;
+
+      auto ghost = std::find(ring.begin(), ring.end(), GHOST);
+      const bool onHull = ghost != ring.end();
+      if (onHull)
+      {
+         // Put the vertex at infinity last so the finite sites form one chain
+         auto shift = ghost - ring.begin() + 1;
+         std::rotate(ring.begin(), ring.begin() + shift, ring.end());
+         std::rotate(ringTwins.begin(), ringTwins.begin() + shift, ringTwins.end());
+      }
+
+      auto isEar = [this](int prev, int curr, int next)
+      {
+         const auto &a = positions[ring[prev]];
+         const auto &b = positions[ring[curr]];
+         const auto &c = positions[ring[next]];
+         if (GeoUtils::orient2d(a, b, c) <= 0.0)
+            return false;
+         for (int other : ring)
+         {
+            if (other == GHOST || other == ring[prev] || other == ring[curr] || other == ring[next])
+               continue;
+            const auto &q = positions[other];
+            if (GeoUtils::orient2d(a, b, q) >= 0.0 && GeoUtils::orient2d(b, c, q) >= 0.0 && GeoUtils::orient2d(c, a, q) >= 0.0)
+               return false;
+         }
+         return true;
+      };
+
+      flips.clear();
+      if (!onHull)
+      {
+         while (ring.size() > 3)
+         {
+            const int k = static_cast<int>(ring.size());
+            int best = NONE;
+            for (int i = 0; i < k && best == NONE; ++i)
+            {
+               if (isEar((i + k - 1) % k, i, (i + 1) % k))
+                  best = i;
+            }
+            // Rounding can hide every ear, take the most convex corner and let the flips sort it out
+            for (int i = 0; i < k && best == NONE; ++i)
+            {
+               if (GeoUtils::orient2d(positions[ring[(i + k - 1) % k]], positions[ring[i]], positions[ring[(i + 1) % k]]) > 0.0)
+                  best = i;
+            }
+            best = std::max(best, 0);
+            flips.push_back(3 * clipEar((best + k - 1) % k, best, (best + 1) % k) + 2);
+         }
+
+         int t = addTriangle(ring[0], ring[1], ring[2]);
+         link(3 * t, ringTwins[0]);
+         link(3 * t + 1, ringTwins[1]);
+         link(3 * t + 2, ringTwins[2]);
+      }
+      else
+      {
+         // Clip the ears that stay inside the new hull, then close the remaining convex
+         // chain off with ghost triangles
+         bool clipped = true;
+         while (clipped)
+         {
+            clipped = false;
+            const int last = static_cast<int>(ring.size()) - 2;
+            for (int i = 1; i < last; ++i)
+            {
+               if (isEar(i - 1, i, i + 1))
+               {
+                  flips.push_back(3 * clipEar(i - 1, i, i + 1) + 2);
+                  clipped = true;
+                  break;
+               }
+            }
+         }
+
+         const int chainEnd = static_cast<int>(ring.size()) - 2;
+         int previous = NONE;
+         for (int i = 0; i < chainEnd; ++i)
+         {
+            int t = addTriangle(ring[i], ring[i + 1], GHOST);
+            link(3 * t, ringTwins[i]);
+            if (previous == NONE)
+               link(3 * t + 2, ringTwins.back());
+            else
+               link(3 * t + 2, 3 * previous + 1);
+            previous = t;
+         }
+         link(3 * previous + 1, ringTwins[chainEnd]);
+
+         if (numFinite == 0)
+         {
+            rebuild();
+            return true;
+         }
+      }
+
+      legalize();
+      return false;
+   }
+
+   // Replaces the edge e with the other diagonal of the quad formed by its two triangles
+   void Triangulation::flip(int e)
+   {
+      const int o = halfedges[e];
+      const int t1 = e / 3, t2 = o / 3;
+
+      const int e1 = GeoUtils::nextHalfedge(e), e2 = GeoUtils::prevHalfedge(e);
+      const int o1 = GeoUtils::nextHalfedge(o), o2 = GeoUtils::prevHalfedge(o);
+
+      const int a = triangles[e], b = triangles[e1], c = triangles[e2], d = triangles[o2];
+      const int ca = halfedges[e2], bc = halfedges[e1], ad = halfedges[o1], db = halfedges[o2];
+
+      // (a, b, c) + (b, a, d) -> (c, a, d) + (d, b, c)
+      setTriangle(t1, c, a, d);
+      setTriangle(t2, d, b, c);
+      link(3 * t1, ca);
+      link(3 * t1 + 1, ad);
+      link(3 * t2, db);
+      link(3 * t2 + 1, bc);
+      link(3 * t1 + 2, 3 * t2 + 2);
+
+      flips.push_back(3 * t1);
+      flips.push_back(3 * t1 + 1);
+      flips.push_back(3 * t2);
+      flips.push_back(3 * t2 + 1);
+   }
+
+   // Lawson flips until every queued edge between finite triangles is locally Delaunay
+   void Triangulation::legalize()
+   {
+      while (!flips.empty())
+      {
+         int e = flips.back();
+         flips.pop_back();
+
+         int o = halfedges[e];
+         if (o == NONE || !isLiveTriangle(e / 3) || isGhost(e / 3) || isGhost(o / 3))
+            continue;
+
+         const auto &a = positions[triangles[e]];
+         const auto &b = positions[triangles[GeoUtils::nextHalfedge(e)]];
+         const auto &c = positions[triangles[GeoUtils::prevHalfedge(e)]];
+         const auto &d = positions[triangles[GeoUtils::prevHalfedge(o)]];
+
+         if (inCircumcircle(e / 3, d) && GeoUtils::orient2d(c, a, d) > 0.0 && GeoUtils::orient2d(d, b, c) > 0.0)
+            flip(e);
+      }
+   }
+
+   // Moves v in place when it stays inside the polygon of its neighbours, so only edge flips
+   // are needed to restore the Delaunay property
+   bool Triangulation::tryRelocate(int v, const GeoUtils::Point &p)
+   {
+      collectStar(v);
+      if (std::find(ring.begin(), ring.end(), GHOST) != ring.end())
+         return false;
+
+      const size_t k = ring.size();
+      for (size_t i = 0; i < k; ++i)
+      {
+         if (GeoUtils::orient2d(positions[ring[i]], positions[ring[(i + 1) % k]], p) <= 0.0)
+            return false;
+      }
+
+      positions[v] = p;
+      flips.clear();
+      for (int t : cavity)
+      {
+         updateCircumcircle(t);
+         for (int j = 0; j < 3; ++j)
+         {
+            flips.push_back(3 * t + j);
+            if (triangles[3 * t + j] != GHOST)
+               markChanged(triangles[3 * t + j]);
+         }
+      }
+      legalize();
+      return true;
+   }
+
+   void Triangulation::restoreHidden(const GeoUtils::Point &p)
+   {
+      if (numFinite == 0)
+         return;
+
+      for (auto it = hiddenSites.begin(); it != hiddenSites.end(); ++it)
+      {
+         if (positions[*it] == p && insertVertex(*it))
+         {
+            hiddenSites.erase(it);
+            return;
+         }
+      }
+   }
+
+   int Triangulation::insertSite(const GeoUtils::Point &p)
+   {
+      beginEdit();
+      int site = allocateSite(p);
+      markChanged(site);
+
+      if (numFinite == 0)
+         rebuild();
+      else if (!insertVertex(site))
+         hiddenSites.push_back(site);
+      return site;
+   }
+
+   bool Triangulation::removeSite(int site)
+   {
+      if (!isSite(site))
+         return false;
+
+      beginEdit();
+      markChanged(site);
+      live[site] = 0;
+      --numLive;
+      freeSites.push_back(site);
+
+      if (vertexEdges[site] == NONE)
+      {
+         hiddenSites.erase(std::remove(hiddenSites.begin(), hiddenSites.end(), site), hiddenSites.end());
+         return true;
+      }
+
+      if (!unlinkVertex(site))
+         restoreHidden(positions[site]);
+      return true;
+   }
+
+   bool Triangulation::moveSite(int site, const GeoUtils::Point &p)
+   {
+      if (!isSite(site))
+         return false;
+
+      beginEdit();
+      markChanged(site);
+      const GeoUtils::Point old = positions[site];
+      if (old == p)
+         return true;
+
+      if (vertexEdges[site] == NONE)
+      {
+         positions[site] = p;
+         if (numFinite == 0)
+         {
+            rebuild();
+         }
+         else if (insertVertex(site))
+         {
+            hiddenSites.erase(std::remove(hiddenSites.begin(), hiddenSites.end(), site), hiddenSites.end());
+         }
+         return true;
+      }
+
+      if (tryRelocate(site, p))
+      {
+         restoreHidden(old);
+         return true;
+      }
+
+      positions[site] = p;
+      if (unlinkVertex(site))
+         return true;
+
+      if (!insertVertex(site))
+         hiddenSites.push_back(site);
+      restoreHidden(old);
+      return true;
+   }
+
+   void Triangulation::moveSites(const int *sites, const GeoUtils::Point *targets, size_t count)
+   {
+      // The bookkeeping lives in members rather than the scratch arena, which a fallback move
+      // resets when it has to rebuild
+      beginEdit();
+      auto &slots = moveSlots; // i for each site moved in place
+      auto &old = moveOrigins;
+      auto &touched = moveTriangles;
+      auto &heldBack = heldBackMoves;
+      slots.assign(positions.size(), NONE);
+      old.resize(count);
+      touched.clear();
+      heldBack.clear();
+
+      // Move every site and collect the triangles around them. Coincident sites waiting to
+      // join the mesh could take the place of a moved one, so while there are any, and for
+      // sites not in the mesh, sites are moved one at a time after the rest.
+      const bool inPlace = hiddenSites.empty();
+      ++searchEpoch;
+      for (size_t i = 0; i < count; ++i)
+      {
+         const int v = sites[i];
+         if (!isSite(v) || positions[v] == targets[i])
+            continue;
+         if (!inPlace || vertexEdges[v] == NONE || slots[v] != NONE)
+         {
+            heldBack.push_back(static_cast<int>(i));
+            continue;
+         }
+
+         slots[v] = static_cast<int>(i);
+         old[i] = positions[v];
+         positions[v] = targets[i];
+         const int first = vertexEdges[v];
+         int e = first;
+         do
+         {
+            if (triangleStamps[e / 3] != searchEpoch)
+            {
+               triangleStamps[e / 3] = searchEpoch;
+               touched.push_back(e / 3);
+            }
+            e = halfedges[GeoUtils::prevHalfedge(e)];
+         } while (e != first);
+      }
+
+      // The triangulation still holds if no triangle turned over and the hull is still convex.
+      // A ghost triangle's finite edge runs clockwise around the hull, so neither turn at its
+      // ends may be to the left. Sites of a triangle that fails go back where they were, to be
+      // moved one at a time, until every triangle around the rest holds.
+      auto holds = [this](int t, std::array<int, 4> &vertices)
+      {
+         const int a = triangles[3 * t], b = triangles[3 * t + 1], c = triangles[3 * t + 2];
+         if (a != GHOST && b != GHOST && c != GHOST)
+         {
+            vertices = {a, b, c, GHOST};
+            return GeoUtils::orient2d(positions[a], positions[b], positions[c]) > 0.0;
+         }
+
+         const int k = a == GHOST ? 0 : b == GHOST ? 1 : 2;
+         const int toFirst = 3 * t + k, fromSecond = 3 * t + (k + 2) % 3;
+         const int first = triangles[3 * t + (k + 1) % 3], second = triangles[fromSecond];
+         const int before = triangles[GeoUtils::prevHalfedge(halfedges[toFirst])];
+         const int after = triangles[GeoUtils::prevHalfedge(halfedges[fromSecond])];
+         vertices = {before, first, second, after};
+         return GeoUtils::orient2d(positions[before], positions[first], positions[second]) <= 0.0 &&
+                GeoUtils::orient2d(positions[first], positions[second], positions[after]) <= 0.0;
+      };
+
+      for (bool settled = false; !settled;)
+      {
+         settled = true;
+         std::array<int, 4> vertices;
+         for (int t : touched)
+         {
+            if (holds(t, vertices))
+               continue;
+            for (int v : vertices)
+            {
+               if (v != GHOST && slots[v] != NONE)
+               {
+                  positions[v] = old[slots[v]];
+                  heldBack.push_back(slots[v]);
+                  slots[v] = NONE;
+                  settled = false;
+               }
+            }
+         }
+      }
+
+      // Lawson flips from every edge around the moved sites restore the Delaunay property
+      flips.clear();
+      for (int t : touched)
+      {
+         updateCircumcircle(t);
+         for (int k = 0; k < 3; ++k)
+         {
+            flips.push_back(3 * t + k);
+            if (triangles[3 * t + k] != GHOST)
+               markChanged(triangles[3 * t + k]);
+         }
+      }
+      legalize();
+
+      if (heldBack.empty())
+         return;
+
+      auto &changed = movedSites;
+      changed.assign(changedSites.begin(), changedSites.end());
+      for (int i : heldBack)
+      {
+         moveSite(sites[i], targets[i]);
+         changed.insert(changed.end(), changedSites.begin(), changedSites.end());
+      }
+      beginEdit();
+      for (int site : changed)
+         markChanged(site);
+   }
+
+   GeoUtils::Mesh Triangulation::getMesh() const
+   {
+      GeoUtils::Mesh mesh;
+      getMesh(mesh);
+      return mesh;
+   }
+
+   void Triangulation::getMesh(GeoUtils::Mesh &mesh) const
+   {
+      GeoUtils::Arena arena;
+      getMesh(mesh, arena);
+   }
+
+   void Triangulation::getMesh(GeoUtils::Mesh &mesh, GeoUtils::Arena &arena) const
+   {
+      mesh.points = positions;
+
+      arena.reset();
+      const int numSlots = static_cast<int>(triangles.size() / 3);
+      std::pmr::vector<int> remap(numSlots, NONE, arena.resource());
+      int count = 0;
+      for (int t = 0; t < numSlots; ++t)
+      {
+         if (isLiveTriangle(t) && !isGhost(t))
+            remap[t] = count++;
+      }
+
+      mesh.triangles.resize(3 * count);
+      mesh.halfedges.resize(3 * count);
+      for (int t = 0; t < numSlots; ++t)
+      {
+         if (remap[t] == NONE)
+            continue;
+         for (int k = 0; k < 3; ++k)
+         {
+            int e = 3 * t + k;
+            int twin = halfedges[e];
+            int mapped = remap[twin / 3];
+            mesh.triangles[3 * remap[t] + k] = triangles[e];
+            mesh.halfedges[3 * remap[t] + k] = mapped == NONE ? GeoUtils::NO_HALFEDGE : 3 * mapped + twin % 3;
+         }
+      }
+
+      mesh.circumcenters.resize(count);
+      for (int t = 0; t < numSlots; ++t)
+      {
+         if (remap[t] != NONE)
+            mesh.circumcenters[remap[t]] = {circumX[t], circumY[t]};
+      }
+   }
+}
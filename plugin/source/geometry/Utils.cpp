@@ -1,6 +1,147 @@
 #include "geometry/Utils.h"
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VORONOISE_SSE2 1
+#endif
+
+namespace
+{
+   constexpr double infinity = std::numeric_limits<double>::infinity();
+
+   enum class Side
+   {
+      Left,
+      Right,
+      Bottom,
+      Top
+   };
+
+   template <Side side>
+   inline bool inside(const GeoUtils::Point &p, const GeoUtils::BBox &box)
+   {
+      if constexpr (side == Side::Left)
+         return p.x >= box.minX;
+      else if constexpr (side == Side::Right)
+         return p.x <= box.maxX;
+      else if constexpr (side == Side::Bottom)
+         return p.y >= box.minY;
+      else
+         return p.y <= box.maxY;
+   }
+
+   // Where s -> e crosses the line through the side
+   template <Side side>
+   inline GeoUtils::Point crossing(const GeoUtils::Point &s, const GeoUtils::Point &e, const GeoUtils::BBox &box)
+   {
+      if constexpr (side == Side::Left || side == Side::Right)
+      {
+         const double x = side == Side::Left ? box.minX : box.maxX;
+         return {x, s.y + (e.y - s.y) * (x - s.x) / (e.x - s.x)};
+      }
+      else
+      {
+         const double y = side == Side::Bottom ? box.minY : box.maxY;
+         return {s.x + (e.x - s.x) * (y - s.y) / (e.y - s.y), y};
+      }
+   }
+
+   // Appends the part of the polygon on the inner side of one box side to out
+   template <Side side>
+   void clipSide(const GeoUtils::Point *poly, size_t count, const GeoUtils::BBox &box, std::pmr::vector<GeoUtils::Point> &out)
+   {
+      if (count == 0)
+         return;
+
+      GeoUtils::Point s = poly[count - 1];
+      bool sInside = inside<side>(s, box);
+      for (size_t i = 0; i < count; ++i)
+      {
+         const GeoUtils::Point &e = poly[i];
+         const bool eInside = inside<side>(e, box);
+         if (eInside != sInside)
+            out.push_back(crossing<side>(s, e, box));
+         if (eInside)
+            out.push_back(e);
+         s = e;
+         sInside = eInside;
+      }
+   }
+
+   // Range of t for which from + t * delta lies between low and high. A zero delta is inside
+   // for every t or for none.
+   inline void slabRange(double from, double delta, double low, double high, double &enter, double &leave)
+   {
+      if (delta != 0.0)
+      {
+         const double inverse = 1.0 / delta;
+         const double a = (low - from) * inverse, b = (high - from) * inverse;
+         enter = std::min(a, b);
+         leave = std::max(a, b);
+      }
+      else
+      {
+         const bool outside = from < low || from > high;
+         enter = outside ? infinity : -infinity;
+         leave = outside ? -infinity : infinity;
+      }
+   }
+
+   // Liang–Barsky: clips edge to box in place and returns whether any of it is left. Endpoints
+   // inside the box are kept exactly, moved ones are clamped onto the box.
+   inline bool clipLiangBarsky(GeoUtils::Edge &edge, const GeoUtils::BBox &box)
+   {
+      auto inBox = [&box](const GeoUtils::Point &p)
+      {
+         return p.x >= box.minX && p.x <= box.maxX && p.y >= box.minY && p.y <= box.maxY;
+      };
+      if (inBox(edge.u) && inBox(edge.v))
+         return true;
+
+      const double dx = edge.v.x - edge.u.x, dy = edge.v.y - edge.u.y;
+      double enterX, leaveX, enterY, leaveY;
+      slabRange(edge.u.x, dx, box.minX, box.maxX, enterX, leaveX);
+      slabRange(edge.u.y, dy, box.minY, box.maxY, enterY, leaveY);
+      const double enter = std::max(std::max(0.0, enterX), enterY);
+      const double leave = std::min(std::min(1.0, leaveX), leaveY);
+
+      const GeoUtils::Point u = edge.u;
+      if (enter > 0.0)
+         edge.u = {std::clamp(u.x + enter * dx, box.minX, box.maxX), std::clamp(u.y + enter * dy, box.minY, box.maxY)};
+      if (leave < 1.0)
+         edge.v = {std::clamp(u.x + leave * dx, box.minX, box.maxX), std::clamp(u.y + leave * dy, box.minY, box.maxY)};
+      return enter <= leave;
+   }
+
+#if VORONOISE_SSE2
+   inline __m128d select(__m128d mask, __m128d ifTrue, __m128d ifFalse)
+   {
+      return _mm_or_pd(_mm_and_pd(mask, ifTrue), _mm_andnot_pd(mask, ifFalse));
+   }
+
+   inline __m128d clamp(__m128d value, __m128d low, __m128d high)
+   {
+      return _mm_min_pd(_mm_max_pd(value, low), high);
+   }
+
+   // slabRange() for two edges at once
+   inline void slabRange(__m128d from, __m128d delta, __m128d low, __m128d high, __m128d &enter, __m128d &leave)
+   {
+      const __m128d inverse = _mm_div_pd(_mm_set1_pd(1.0), delta);
+      const __m128d a = _mm_mul_pd(_mm_sub_pd(low, from), inverse);
+      const __m128d b = _mm_mul_pd(_mm_sub_pd(high, from), inverse);
+      const __m128d flat = _mm_cmpeq_pd(delta, _mm_setzero_pd());
+      const __m128d outside = _mm_or_pd(_mm_cmplt_pd(from, low), _mm_cmpgt_pd(from, high));
+      const __m128d inf = _mm_set1_pd(infinity), negInf = _mm_set1_pd(-infinity);
+      enter = select(flat, select(outside, inf, negInf), _mm_min_pd(a, b));
+      leave = select(flat, select(outside, negInf, inf), _mm_max_pd(a, b));
+   }
+#endif
+}
 
 namespace GeoUtils
 {
@@ -88,82 +229,113 @@ namespace GeoUtils
 
    std::vector<Point> clipPolygon(const std::vector<Point> &poly, const BBox &box)
    {
-      std::vector<Point> output = poly;
-      for (int edge = 0; edge < 4; ++edge)
-      { // 0: left, 1: right, 2: bottom, 3: top
-         std::vector<Point> input = output;
-         output.clear();
-         if (input.empty())
-            break;
+      std::pmr::vector<Point> output;
+      ClipScratch scratch;
+      clipPolygon(poly.data(), poly.size(), box, output, scratch);
+      return {output.begin(), output.end()};
+   }
+
+   // Sutherland–Hodgman, one pass per side of the box, ping-ponging between the scratch buffers
+   size_t clipPolygon(const Point *poly, size_t count, const BBox &box, std::pmr::vector<Point> &out, ClipScratch &scratch)
+   {
+      scratch.first.clear();
+      clipSide<Side::Left>(poly, count, box, scratch.first);
+      scratch.second.clear();
+      clipSide<Side::Right>(scratch.first.data(), scratch.first.size(), box, scratch.second);
+      scratch.first.clear();
+      clipSide<Side::Bottom>(scratch.second.data(), scratch.second.size(), box, scratch.first);
+
+      const size_t before = out.size();
+      clipSide<Side::Top>(scratch.first.data(), scratch.first.size(), box, out);
+      return out.size() - before;
+   }
+
+   void clipPolygons(const std::vector<Point> &vertices, const std::vector<int> &offsets, const BBox &box,
+                     std::pmr::vector<Point> &outVertices, std::pmr::vector<int> &outOffsets, ClipScratch &scratch)
+   {
+      outVertices.clear();
+      outOffsets.clear();
+      if (offsets.empty())
+         return;
+
+      outOffsets.push_back(0);
+      for (size_t i = 0; i + 1 < offsets.size(); ++i)
+      {
+         clipPolygon(vertices.data() + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i]), box, outVertices, scratch);
+         outOffsets.push_back(static_cast<int>(outVertices.size()));
+      }
+   }
 
-         Point S = input.back();
-         for (const Point &E : input)
+   size_t clipEdges(Edge *edges, size_t count, const BBox &box)
+   {
+      // Clip a block of edges without looking at the results, then keep the ones that touch the box
+      static_assert(sizeof(Edge) == 4 * sizeof(double), "the SSE2 path reads edges as four packed doubles");
+      constexpr size_t blockSize = 64;
+      uint8_t keep[blockSize];
+      size_t kept = 0;
+      for (size_t begin = 0; begin < count; begin += blockSize)
+      {
+         Edge *block = edges + begin;
+         const size_t n = std::min(blockSize, count - begin);
+         size_t i = 0;
+#if VORONOISE_SSE2
+         const __m128d minX = _mm_set1_pd(box.minX), maxX = _mm_set1_pd(box.maxX);
+         const __m128d minY = _mm_set1_pd(box.minY), maxY = _mm_set1_pd(box.maxY);
+         const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0);
+         for (; i + 2 <= n; i += 2)
          {
-            bool s_inside = (edge == 0) ? S.x >= box.minX : (edge == 1) ? S.x <= box.maxX
-                                                        : (edge == 2)   ? S.y >= box.minY
-                                                                        : S.y <= box.maxY;
-            bool e_inside = (edge == 0) ? E.x >= box.minX : (edge == 1) ? E.x <= box.maxX
-                                                        : (edge == 2)   ? E.y >= box.minY
-                                                                        : E.y <= box.maxY;
-
-            if (e_inside)
-            {
-               if (!s_inside)
-               {
-                  // Intersect S->E with the boundary
-                  double ix, iy;
-                  if (edge == 0)
-                  {
-                     ix = box.minX;
-                     iy = S.y + (E.y - S.y) * (box.minX - S.x) / (E.x - S.x);
-                  }
-                  else if (edge == 1)
-                  {
-                     ix = box.maxX;
-                     iy = S.y + (E.y - S.y) * (box.maxX - S.x) / (E.x - S.x);
-                  }
-                  else if (edge == 2)
-                  {
-                     iy = box.minY;
-                     ix = S.x + (E.x - S.x) * (box.minY - S.y) / (E.y - S.y);
-                  }
-                  else
-                  {
-                     iy = box.maxY;
-                     ix = S.x + (E.x - S.x) * (box.maxY - S.y) / (E.y - S.y);
-                  }
-                  output.push_back({ix, iy});
-               }
-               output.push_back(E);
-            }
-            else if (s_inside)
+            // Each point is an (x, y) pair in memory; unpacking two of them gives the x and y lanes
+            double *e0 = &block[i].u.x, *e1 = &block[i + 1].u.x;
+            const __m128d u0 = _mm_loadu_pd(e0), v0 = _mm_loadu_pd(e0 + 2);
+            const __m128d u1 = _mm_loadu_pd(e1), v1 = _mm_loadu_pd(e1 + 2);
+            const __m128d ux = _mm_unpacklo_pd(u0, u1), uy = _mm_unpackhi_pd(u0, u1);
+            const __m128d vx = _mm_unpacklo_pd(v0, v1), vy = _mm_unpackhi_pd(v0, v1);
+
+            // Both edges inside the box is the common case when clipping to the visible area
+            const __m128d uInside = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(ux, minX), _mm_cmple_pd(ux, maxX)),
+                                               _mm_and_pd(_mm_cmpge_pd(uy, minY), _mm_cmple_pd(uy, maxY)));
+            const __m128d vInside = _mm_and_pd(_mm_and_pd(_mm_cmpge_pd(vx, minX), _mm_cmple_pd(vx, maxX)),
+                                               _mm_and_pd(_mm_cmpge_pd(vy, minY), _mm_cmple_pd(vy, maxY)));
+            if (_mm_movemask_pd(_mm_and_pd(uInside, vInside)) == 3)
             {
-               double ix, iy;
-               if (edge == 0)
-               {
-                  ix = box.minX;
-                  iy = S.y + (E.y - S.y) * (box.minX - S.x) / (E.x - S.x);
-               }
-               else if (edge == 1)
-               {
-                  ix = box.maxX;
-                  iy = S.y + (E.y - S.y) * (box.maxX - S.x) / (E.x - S.x);
-               }
-               else if (edge == 2)
-               {
-                  iy = box.minY;
-                  ix = S.x + (E.x - S.x) * (box.minY - S.y) / (E.y - S.y);
-               }
-               else
-               {
-                  iy = box.maxY;
-                  ix = S.x + (E.x - S.x) * (box.maxY - S.y) / (E.y - S.y);
-               }
-               output.push_back({ix, iy});
+               keep[i] = keep[i + 1] = 1;
+               continue;
             }
-            S = E;
+
+            const __m128d dx = _mm_sub_pd(vx, ux), dy = _mm_sub_pd(vy, uy);
+
+            __m128d enterX, leaveX, enterY, leaveY;
+            slabRange(ux, dx, minX, maxX, enterX, leaveX);
+            slabRange(uy, dy, minY, maxY, enterY, leaveY);
+            const __m128d enter = _mm_max_pd(_mm_max_pd(zero, enterX), enterY);
+            const __m128d leave = _mm_min_pd(_mm_min_pd(one, leaveX), leaveY);
+            const int touches = _mm_movemask_pd(_mm_cmple_pd(enter, leave));
+            keep[i] = touches & 1;
+            keep[i + 1] = (touches >> 1) & 1;
+
+            // Endpoints inside the box stay exactly as they were
+            const __m128d moveU = _mm_cmpgt_pd(enter, zero), moveV = _mm_cmplt_pd(leave, one);
+            const __m128d newUx = select(moveU, clamp(_mm_add_pd(ux, _mm_mul_pd(enter, dx)), minX, maxX), ux);
+            const __m128d newUy = select(moveU, clamp(_mm_add_pd(uy, _mm_mul_pd(enter, dy)), minY, maxY), uy);
+            const __m128d newVx = select(moveV, clamp(_mm_add_pd(ux, _mm_mul_pd(leave, dx)), minX, maxX), vx);
+            const __m128d newVy = select(moveV, clamp(_mm_add_pd(uy, _mm_mul_pd(leave, dy)), minY, maxY), vy);
+
+            _mm_storeu_pd(e0, _mm_unpacklo_pd(newUx, newUy));
+            _mm_storeu_pd(e0 + 2, _mm_unpacklo_pd(newVx, newVy));
+            _mm_storeu_pd(e1, _mm_unpackhi_pd(newUx, newUy));
+            _mm_storeu_pd(e1 + 2, _mm_unpackhi_pd(newVx, newVy));
+         }
+#endif
+         for (; i < n; ++i)
+            keep[i] = clipLiangBarsky(block[i], box);
+
+         // Always copying and advancing conditionally avoids a branch that is hard to predict
+         for (size_t k = 0; k < n; ++k)
+         {
+            edges[kept] = block[k];
+            kept += keep[k];
          }
       }
-      return output;
+      return kept;
    }
 }
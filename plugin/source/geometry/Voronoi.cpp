@@ -1,132 +1,441 @@
 #include "geometry/Voronoi.h"
-#include <set>
 #include <cmath>
 #include <algorithm>
 #include <numeric>
+#include <cstdint>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VORONOISE_SSE2 1
+#endif
+
+namespace
+{
+   // Where the ray from origin (inside box) along direction leaves box; the coordinate on the
+   // side it crosses is set exactly to that side
+   GeoUtils::Point rayExit(const GeoUtils::BBox &box, const GeoUtils::Point &origin, const GeoUtils::Point &direction)
+   {
+      double tx = std::numeric_limits<double>::infinity(), ty = tx;
+      if (direction.x > 0.0)
+         tx = (box.maxX - origin.x) / direction.x;
+      else if (direction.x < 0.0)
+         tx = (box.minX - origin.x) / direction.x;
+      if (direction.y > 0.0)
+         ty = (box.maxY - origin.y) / direction.y;
+      else if (direction.y < 0.0)
+         ty = (box.minY - origin.y) / direction.y;
+
+      if (tx <= ty)
+      {
+         double y = std::clamp(origin.y + tx * direction.y, box.minY, box.maxY);
+         return {direction.x > 0.0 ? box.maxX : box.minX, y};
+      }
+      double x = std::clamp(origin.x + ty * direction.x, box.minX, box.maxX);
+      return {x, direction.y > 0.0 ? box.maxY : box.minY};
+   }
+
+   // Position of a point on the box outline, counter-clockwise from (minX, minY): the bottom
+   // side covers [0, 1), the right side [1, 2), the top [2, 3) and the left [3, 4)
+   double boundaryParameter(const GeoUtils::BBox &box, const GeoUtils::Point &p)
+   {
+      const double w = box.maxX - box.minX, h = box.maxY - box.minY;
+      if (p.y == box.minY && p.x < box.maxX)
+         return (p.x - box.minX) / w;
+      if (p.x == box.maxX && p.y < box.maxY)
+         return 1.0 + (p.y - box.minY) / h;
+      if (p.y == box.maxY && p.x > box.minX)
+         return 2.0 + (box.maxX - p.x) / w;
+      return 3.0 + (box.maxY - p.y) / h;
+   }
+
+   // Circumcentre of every triangle into centres, with a flag for the ones that have none.
+   // Reuses the centres the triangulator already cached and computes them only for loose
+   // triangles.
+   template <typename Points, typename Flags>
+   void circumcentres(const GeoUtils::Mesh &mesh, Points &centres, Flags &valid)
+   {
+      const size_t numTris = mesh.numTriangles();
+      valid.assign(numTris, 1);
+      if (mesh.circumcenters.size() == numTris)
+      {
+         centres.assign(mesh.circumcenters.begin(), mesh.circumcenters.end());
+         return;
+      }
+
+      centres.clear();
+      centres.reserve(numTris);
+      for (size_t t = 0; t < numTris; ++t)
+      {
+         auto cc = Delaunay::getCircumcircle(mesh.getTriangle(t));
+         centres.push_back(cc.center);
+         valid[t] = cc.valid;
+      }
+   }
+
+   // Cells of a run of consecutive sites, built apart from the others in the run's own arena.
+   // Vertex ids >= 0 are circumcentres shared by the whole diagram, ~k is the k-th vertex the
+   // run added itself.
+   struct CellRun
+   {
+      explicit CellRun(std::pmr::memory_resource *resource)
+          : sizes(resource), cellVertices(resource), ownVertices(resource)
+      {
+      }
+
+      std::pmr::vector<int> sizes;
+      std::pmr::vector<int> cellVertices;
+      std::pmr::vector<GeoUtils::Point> ownVertices;
+   };
+
+   // Fixed so the diagram comes out the same for any number of threads
+   constexpr size_t sitesPerRun = 2048;
+
+   // Appends the box corners passed when going counter-clockwise from parameter from to to
+   void appendCorners(const GeoUtils::BBox &box, double from, double to, std::pmr::vector<GeoUtils::Point> &polygon, std::pmr::vector<int> &ids)
+   {
+      const GeoUtils::Point corners[4] = {{box.minX, box.minY}, {box.maxX, box.minY}, {box.maxX, box.maxY}, {box.minX, box.maxY}};
+      double span = to - from;
+      if (span < 0.0)
+         span += 4.0;
+
+      const double firstCorner = std::floor(from) + 1.0;
+      for (int k = 0; k < 4; ++k)
+      {
+         double corner = firstCorner + k;
+         if (corner - from >= span)
+            break;
+         polygon.push_back(corners[static_cast<int>(corner) % 4]);
+         ids.push_back(-1);
+      }
+   }
+}
 
 namespace Voronoi
 {
 
-   std::vector<GeoUtils::Edge> getEdges(const std::vector<GeoUtils::Triangle> &tris, const GeoUtils::BBox &bbox)
+   std::vector<GeoUtils::Edge> getEdges(const GeoUtils::Mesh &mesh, const GeoUtils::BBox &bbox)
    {
-      auto voronoiCells = getCells(tris, bbox);
-      std::set<GeoUtils::Edge, GeoUtils::EdgeComparator> edges;
+      std::vector<GeoUtils::Edge> edges;
+      GeoUtils::Arena scratch;
+      getEdges(mesh, bbox, edges, scratch);
+      return edges;
+   }
 
-      for (const auto &kv : voronoiCells)
+   void getEdges(const GeoUtils::Mesh &mesh, const GeoUtils::BBox &bbox, std::vector<GeoUtils::Edge> &edges, GeoUtils::Arena &scratch)
+   {
+      scratch.reset();
+      std::pmr::vector<GeoUtils::Point> centres(scratch.resource());
+      std::pmr::vector<uint8_t> valid(scratch.resource());
+      circumcentres(mesh, centres, valid);
+      edges.clear();
+      edges.reserve((mesh.triangles.size() + mesh.points.size()) / 2 + 1); // a hull has at most one edge per site
+
+      // One edge per Delaunay edge: between the circumcentres of the two triangles sharing it,
+      // or for a hull edge a ray from the circumcentre away from the triangle. All of them are
+      // clipped to the box in one batch at the end.
+      for (size_t e = 0; e < mesh.triangles.size(); ++e)
       {
-         const auto &vertices = kv.second.vertices;
-         if (vertices.size() < 2)
+         const int twin = mesh.halfedges[e];
+         if (twin != GeoUtils::NO_HALFEDGE && twin < static_cast<int>(e))
+            continue;
+
+         const int t = static_cast<int>(e) / 3;
+         if (!valid[t] || (twin != GeoUtils::NO_HALFEDGE && !valid[twin / 3]))
             continue;
-         for (size_t i = 0; i < vertices.size(); ++i)
+
+         GeoUtils::Edge edge;
+         edge.u = centres[t];
+         if (twin != GeoUtils::NO_HALFEDGE)
          {
-            GeoUtils::Edge e = {vertices[i], vertices[(i + 1) % vertices.size()]};
-            if (e.u.x < e.v.x || (e.u.x == e.v.x && e.u.y < e.v.y))
-               edges.insert(e);
-            else
-               edges.insert({e.v, e.u});
+            edge.v = centres[twin / 3];
          }
+         else
+         {
+            const auto &from = mesh.points[mesh.triangles[e]];
+            const auto &to = mesh.points[mesh.triangles[GeoUtils::nextHalfedge(static_cast<int>(e))]];
+            GeoUtils::BBox box = {std::min(bbox.minX, edge.u.x), std::min(bbox.minY, edge.u.y),
+                                  std::max(bbox.maxX, edge.u.x), std::max(bbox.maxY, edge.u.y)};
+            edge.v = rayExit(box, edge.u, {to.y - from.y, from.x - to.x});
+         }
+
+         if (edge.u != edge.v)
+            edges.push_back(edge);
       }
-      return std::vector<GeoUtils::Edge>(edges.begin(), edges.end());
+      edges.resize(GeoUtils::clipEdges(edges.data(), edges.size(), bbox));
    }
 
-   std::map<GeoUtils::Point, Cell, GeoUtils::PointComparator> getCells(const std::vector<GeoUtils::Triangle> &tris, const GeoUtils::BBox &bbox)
+   std::vector<GeoUtils::Edge> getEdges(const std::vector<GeoUtils::Triangle> &tris, const GeoUtils::BBox &bbox)
    {
-      std::map<GeoUtils::Point, Cell, GeoUtils::PointComparator> cells;
-      if (tris.empty())
-         return cells;
+      return getEdges(GeoUtils::Mesh::fromTriangles(tris), bbox);
+   }
+
+   Diagram getDiagram(const GeoUtils::Mesh &mesh, const GeoUtils::BBox &bbox, GeoUtils::TaskPool *pool)
+   {
+      Diagram diagram;
+      Workspace workspace;
+      getDiagram(mesh, bbox, diagram, workspace, pool);
+      return diagram;
+   }
+
+   void getDiagram(const GeoUtils::Mesh &mesh, const GeoUtils::BBox &bbox, Diagram &diagram, Workspace &workspace,
+                   GeoUtils::TaskPool *pool)
+   {
+      diagram.sites = mesh.points;
+      diagram.vertices.clear();
+      diagram.cellVertices.clear();
+      diagram.cellOffsets.assign(mesh.points.size() + 1, 0);
+
+      const size_t numTris = mesh.numTriangles();
+      if (numTris == 0)
+         return;
 
-      std::map<GeoUtils::Point, std::vector<size_t>, GeoUtils::PointComparator> siteToTriangles;
-      for (size_t i = 0; i < tris.size(); ++i)
+      workspace.shared.reset();
+      auto *shared = workspace.shared.resource();
+
+      // One half-edge leaving each site, preferring the hull edge so hull fans start at their first triangle
+      std::pmr::vector<int> leaving(mesh.points.size(), GeoUtils::NO_HALFEDGE, shared);
+      for (size_t e = 0; e < mesh.triangles.size(); ++e)
       {
-         siteToTriangles[tris[i].a].push_back(i);
-         siteToTriangles[tris[i].b].push_back(i);
-         siteToTriangles[tris[i].c].push_back(i);
+         int &slot = leaving[mesh.triangles[e]];
+         if (slot == GeoUtils::NO_HALFEDGE || mesh.halfedges[e] == GeoUtils::NO_HALFEDGE)
+            slot = static_cast<int>(e);
       }
 
-      std::vector<GeoUtils::Circumcircle> circumcenters;
-      circumcenters.reserve(tris.size());
-      for (const auto &t : tris)
+      // Vertex t is the circumcentre of triangle t
+      std::pmr::vector<uint8_t> valid(shared);
+      circumcentres(mesh, diagram.vertices, valid);
+
+      auto inside = [&bbox](const GeoUtils::Point &p)
       {
-         circumcenters.push_back(Delaunay::getCircumcircle(t));
+         return p.x >= bbox.minX && p.x <= bbox.maxX && p.y >= bbox.minY && p.y <= bbox.maxY;
+      };
+
+      // Each run of sites is built on its own, only reading the mesh and the circumcentres
+      const size_t numSites = mesh.points.size();
+      const size_t numRuns = (numSites + sitesPerRun - 1) / sitesPerRun;
+      while (workspace.runs.size() < numRuns)
+         workspace.runs.emplace_back();
+
+      std::pmr::vector<CellRun> runs(shared);
+      runs.reserve(numRuns);
+      for (size_t r = 0; r < numRuns; ++r)
+      {
+         workspace.runs[r].reset();
+         runs.emplace_back(workspace.runs[r].resource());
       }
 
-      for (const auto &pair : siteToTriangles)
+      auto buildRun = [&](int r)
       {
-         const auto &site = pair.first;
-         const auto &tri_indices = pair.second;
+         auto &run = runs[r];
+         auto *memory = workspace.runs[r].resource();
+         const size_t begin = r * sitesPerRun, end = std::min(begin + sitesPerRun, numSites);
+         run.sizes.assign(end - begin, 0);
+         run.cellVertices.reserve(6 * (end - begin));
+
+         // Polygon of the current cell before clipping; ids are vertex indices, or -1 for points
+         // on the box that belong to this cell only
+         std::pmr::vector<GeoUtils::Point> polygon(memory);
+         std::pmr::vector<int> ids(memory);
+         GeoUtils::ClipScratch scratch(memory);
+         const size_t maxSteps = mesh.triangles.size();
 
-         std::vector<GeoUtils::Point> cell_vertices;
-         for (auto tri_idx : tri_indices)
+         for (size_t v = begin; v < end; ++v)
          {
-            if (circumcenters[tri_idx].valid)
+            polygon.clear();
+            ids.clear();
+
+            const int first = leaving[v];
+            if (first == GeoUtils::NO_HALFEDGE)
+               continue;
+
+            // Triangles around the site in counter-clockwise order give the Voronoi vertices in
+            // counter-clockwise order; the walk stops early at the hull
+            int e = first, last = first;
+            bool onHull = mesh.halfedges[first] == GeoUtils::NO_HALFEDGE;
+            for (size_t steps = 0; steps < maxSteps; ++steps)
             {
-               cell_vertices.push_back(circumcenters[tri_idx].center);
+               if (valid[e / 3])
+               {
+                  polygon.push_back(diagram.vertices[e / 3]);
+                  ids.push_back(e / 3);
+               }
+               last = e;
+               int in = mesh.halfedges[GeoUtils::prevHalfedge(e)];
+               if (in == GeoUtils::NO_HALFEDGE || in == first)
+                  break;
+               e = in;
             }
-         }
 
-         for (auto tri_idx : tri_indices)
-         {
-            const auto &tri = tris[tri_idx];
-            GeoUtils::Point p[3] = {tri.a, tri.b, tri.c};
-            for (int i = 0; i < 3; ++i)
+            bool clipped = !std::all_of(polygon.begin(), polygon.end(), inside);
+            if (onHull && !polygon.empty())
             {
-               GeoUtils::Point p1 = p[i];
-               GeoUtils::Point p2 = p[(i + 1) % 3];
-               if (!((GeoUtils::pointsEqual(p1, site) || GeoUtils::pointsEqual(p2, site)) && !GeoUtils::pointsEqual(p1, p2)))
-                  continue;
-
-               bool is_hull_edge = true;
-               for (auto other_tri_idx : tri_indices)
+               // Unbounded cell: the rays leave the first and last Voronoi vertex perpendicular to
+               // the hull edges, and are cut where they cross a box that holds the whole finite
+               // part of the cell. The stretch of box boundary between them closes the polygon.
+               GeoUtils::BBox box = bbox;
+               for (const auto &p : polygon)
                {
-                  if (tri_idx == other_tri_idx)
-                     continue;
-                  const auto &other_tri = tris[other_tri_idx];
-                  if ((GeoUtils::pointsEqual(other_tri.a, p1) || GeoUtils::pointsEqual(other_tri.b, p1) || GeoUtils::pointsEqual(other_tri.c, p1)) &&
-                      (GeoUtils::pointsEqual(other_tri.a, p2) || GeoUtils::pointsEqual(other_tri.b, p2) || GeoUtils::pointsEqual(other_tri.c, p2)))
-                  {
-                     is_hull_edge = false;
-                     break;
-                  }
+                  box.minX = std::min(box.minX, p.x);
+                  box.minY = std::min(box.minY, p.y);
+                  box.maxX = std::max(box.maxX, p.x);
+                  box.maxY = std::max(box.maxY, p.y);
                }
-               if (is_hull_edge)
+
+               const auto &site = mesh.points[v];
+               const auto &next = mesh.points[mesh.triangles[GeoUtils::nextHalfedge(first)]];
+               const auto &previous = mesh.points[mesh.triangles[GeoUtils::prevHalfedge(last)]];
+               GeoUtils::Point exit = rayExit(box, polygon.back(), {site.y - previous.y, previous.x - site.x});
+               GeoUtils::Point entry = rayExit(box, polygon.front(), {next.y - site.y, site.x - next.x});
+
+               polygon.push_back(exit);
+               ids.push_back(-1);
+               appendCorners(box, boundaryParameter(box, exit), boundaryParameter(box, entry), polygon, ids);
+               polygon.push_back(entry);
+               ids.push_back(-1);
+            }
+
+            if (polygon.size() < 3)
+               continue;
+
+            const size_t before = run.cellVertices.size();
+            if (!clipped)
+            {
+               for (size_t i = 0; i < polygon.size(); ++i)
                {
-                  GeoUtils::Point mid = {(p1.x + p2.x) / 2.0, (p1.y + p2.y) / 2.0};
-                  GeoUtils::Point normal = {p2.y - p1.y, p1.x - p2.x};
-                  GeoUtils::Point third_pt = p[(i + 2) % 3];
-                  if ((mid.x - third_pt.x) * normal.x + (mid.y - third_pt.y) * normal.y < 0)
+                  if (ids[i] < 0)
                   {
-                     normal.x = -normal.x;
-                     normal.y = -normal.y;
+                     ids[i] = ~static_cast<int>(run.ownVertices.size());
+                     run.ownVertices.push_back(polygon[i]);
                   }
-                  double far_dist = 2.0 * (bbox.maxX - bbox.minX + bbox.maxY - bbox.minY);
-                  cell_vertices.push_back({circumcenters[tri_idx].center.x + normal.x * far_dist,
-                                           circumcenters[tri_idx].center.y + normal.y * far_dist});
+                  run.cellVertices.push_back(ids[i]);
                }
             }
+            else
+            {
+               const size_t added = GeoUtils::clipPolygon(polygon.data(), polygon.size(), bbox, run.ownVertices, scratch);
+               for (size_t k = run.ownVertices.size() - added; k < run.ownVertices.size(); ++k)
+                  run.cellVertices.push_back(~static_cast<int>(k));
+            }
+            run.sizes[v - begin] = static_cast<int>(run.cellVertices.size() - before);
          }
+      };
+      GeoUtils::parallelFor(pool, static_cast<int>(numRuns), buildRun);
 
-         if (cell_vertices.size() < 2)
-            continue;
-         GeoUtils::Point center = {0, 0};
-         for (const auto &v : cell_vertices)
+      // Every run gets its own stretch of the flat arrays, in site order
+      std::pmr::vector<size_t> vertexStarts(numRuns + 1, numTris, shared), indexStarts(numRuns + 1, 0, shared);
+      for (size_t r = 0; r < numRuns; ++r)
+      {
+         vertexStarts[r + 1] = vertexStarts[r] + runs[r].ownVertices.size();
+         indexStarts[r + 1] = indexStarts[r] + runs[r].cellVertices.size();
+      }
+      diagram.vertices.resize(vertexStarts[numRuns]);
+      diagram.cellVertices.resize(indexStarts[numRuns]);
+
+      auto placeRun = [&](int r)
+      {
+         const auto &run = runs[r];
+         std::copy(run.ownVertices.begin(), run.ownVertices.end(), diagram.vertices.begin() + static_cast<long>(vertexStarts[r]));
+
+         const int ownStart = static_cast<int>(vertexStarts[r]);
+         auto index = static_cast<int>(indexStarts[r]);
+         for (int id : run.cellVertices)
+            diagram.cellVertices[index++] = id >= 0 ? id : ownStart + ~id;
+
+         index = static_cast<int>(indexStarts[r]);
+         const size_t begin = r * sitesPerRun;
+         for (size_t i = 0; i < run.sizes.size(); ++i)
          {
-            center.x += v.x;
-            center.y += v.y;
+            diagram.cellOffsets[begin + i] = index;
+            index += run.sizes[i];
          }
-         center.x /= cell_vertices.size();
-         center.y /= cell_vertices.size();
+      };
+      GeoUtils::parallelFor(pool, static_cast<int>(numRuns), placeRun);
 
-         std::sort(cell_vertices.begin(), cell_vertices.end(), [center](const GeoUtils::Point &a, const GeoUtils::Point &b)
-                   { return std::atan2(a.y - center.y, a.x - center.x) < std::atan2(b.y - center.y, b.x - center.x); });
+      diagram.cellOffsets[numSites] = static_cast<int>(diagram.cellVertices.size());
+   }
+
+   void getCentroids(const Diagram &diagram, std::vector<GeoUtils::Point> &centroids, std::vector<double> &areas)
+   {
+      static_assert(sizeof(GeoUtils::Point) == 2 * sizeof(double), "the SSE2 path reads points as two packed doubles");
+      const size_t numCells = diagram.numCells();
+      centroids.resize(numCells);
+      areas.resize(numCells);
 
-         Voronoi::Cell cell;
-         cell.vertices = GeoUtils::clipPolygon(cell_vertices, bbox);
+      for (size_t c = 0; c < numCells; ++c)
+      {
+         const int n = diagram.cellSize(c);
+         const auto &site = diagram.sites[c];
+         const int *ids = diagram.cellVertices.data() + diagram.cellOffsets[c];
+
+         // Shoelace sums over the edges, relative to the site so that coordinates far from the
+         // origin lose no precision: twice the area, and six times the area times the centroid
+         double doubleArea = 0.0, sumX = 0.0, sumY = 0.0;
+#if VORONOISE_SSE2
+         // x in the low lane and y in the high lane; each edge's cross product is spread over
+         // both lanes, so one multiply-add moves the centroid sum in x and y at once
+         const __m128d origin = _mm_loadu_pd(&site.x);
+         __m128d sum = _mm_setzero_pd(), cross2 = _mm_setzero_pd();
+         __m128d a = n > 0 ? _mm_sub_pd(_mm_loadu_pd(&diagram.vertices[ids[n - 1]].x), origin) : origin;
+         for (int k = 0; k < n; ++k)
+         {
+            const __m128d b = _mm_sub_pd(_mm_loadu_pd(&diagram.vertices[ids[k]].x), origin);
+            const __m128d products = _mm_mul_pd(a, _mm_shuffle_pd(b, b, 1)); // a.x * b.y, a.y * b.x
+            __m128d cross = _mm_sub_sd(products, _mm_unpackhi_pd(products, products));
+            cross = _mm_unpacklo_pd(cross, cross);
+            cross2 = _mm_add_pd(cross2, cross);
+            sum = _mm_add_pd(sum, _mm_mul_pd(_mm_add_pd(a, b), cross));
+            a = b;
+         }
+         doubleArea = _mm_cvtsd_f64(cross2);
+         sumX = _mm_cvtsd_f64(sum);
+         sumY = _mm_cvtsd_f64(_mm_unpackhi_pd(sum, sum));
+#else
+         for (int k = 0, j = n - 1; k < n; j = k++)
+         {
+            const auto &pa = diagram.vertices[ids[j]];
+            const auto &pb = diagram.vertices[ids[k]];
+            const double ax = pa.x - site.x, ay = pa.y - site.y, bx = pb.x - site.x, by = pb.y - site.y;
+            const double cross = ax * by - bx * ay;
+            doubleArea += cross;
+            sumX += (ax + bx) * cross;
+            sumY += (ay + by) * cross;
+         }
+#endif
 
-         if (!cell.vertices.empty())
+         // Sites without a cell, or with a degenerate one, stay where they are
+         if (n < 3 || doubleArea <= 0.0)
          {
-            cells[site] = cell;
+            areas[c] = 0.0;
+            centroids[c] = site;
+            continue;
          }
+         areas[c] = 0.5 * doubleArea;
+         centroids[c] = {site.x + sumX / (3.0 * doubleArea), site.y + sumY / (3.0 * doubleArea)};
+      }
+   }
+
+   std::map<GeoUtils::Point, Cell, GeoUtils::PointComparator> getCells(const GeoUtils::Mesh &mesh, const GeoUtils::BBox &bbox, GeoUtils::TaskPool *pool)
+   {
+      auto diagram = getDiagram(mesh, bbox, pool);
+      std::map<GeoUtils::Point, Cell, GeoUtils::PointComparator> cells;
+      for (size_t c = 0; c < diagram.numCells(); ++c)
+      {
+         const int n = diagram.cellSize(c);
+         if (n == 0)
+            continue;
+
+         Cell cell;
+         cell.vertices.reserve(n);
+         for (int k = 0; k < n; ++k)
+            cell.vertices.push_back(diagram.cellVertex(c, k));
+         cells[diagram.sites[c]] = std::move(cell);
       }
       return cells;
    }
+
+   std::map<GeoUtils::Point, Cell, GeoUtils::PointComparator> getCells(const std::vector<GeoUtils::Triangle> &tris, const GeoUtils::BBox &bbox)
+   {
+      return getCells(GeoUtils::Mesh::fromTriangles(tris), bbox);
+   }
 }
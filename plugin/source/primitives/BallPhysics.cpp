@@ -0,0 +1,174 @@
+#include "primitives/BallPhysics.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+   // A ball wedged into a sharp corner stops there for the rest of the block
+   constexpr int MAX_BOUNCES_PER_BLOCK = 8;
+
+   constexpr double NOTE_SECONDS = 0.2;
+
+   // Impact speed, in units per second, that plays a note at full velocity
+   constexpr double FULL_VELOCITY_SPEED = 1000.0;
+
+   int frequencyToNote(float frequency)
+   {
+      const double note = 69.0 + 12.0 * std::log2(std::max(frequency, 1.f) / 440.0);
+      return std::clamp(static_cast<int>(std::lround(note)), 0, 127);
+   }
+}
+
+void BallPhysics::prepare(double newSampleRate, int maxBalls)
+{
+   sampleRate = newSampleRate;
+   capacity = static_cast<size_t>(std::max(maxBalls, 0));
+   for (auto *values : {&x, &y, &vx, &vy, &radius})
+   {
+      values->clear();
+      values->reserve(capacity);
+   }
+   for (auto *values : {&note, &site, &samplesLeftAlive, &samplesLeftSounding})
+   {
+      values->clear();
+      values->reserve(capacity);
+   }
+}
+
+bool BallPhysics::launch(const Ball &ball)
+{
+   if (x.size() >= capacity)
+      return false;
+
+   const double speed = ball.velocity / sampleRate;
+   x.push_back(ball.position.x);
+   y.push_back(ball.position.y);
+   vx.push_back(speed * std::cos(ball.angle));
+   vy.push_back(speed * std::sin(ball.angle));
+   radius.push_back(std::max(ball.radius, 0.f));
+   note.push_back(frequencyToNote(ball.frequency));
+   site.push_back(ball.site);
+   samplesLeftAlive.push_back(std::max(1, static_cast<int>(std::lround(ball.timeLeftAlive * sampleRate))));
+   samplesLeftSounding.push_back(-1);
+   return true;
+}
+
+void BallPhysics::process(int numSamples, const GeoUtils::EdgeGrid &edges, std::vector<BallNote> &notes)
+{
+   if (numSamples <= 0)
+      return;
+
+   auto emit = [&notes](int sample, int number, float velocity, int from)
+   {
+      if (notes.size() < notes.capacity())
+         notes.push_back({sample, number, velocity, from});
+   };
+   const int noteSamples = std::max(1, static_cast<int>(NOTE_SECONDS * sampleRate));
+
+   // Backwards, so retiring a ball only moves one that has been processed already
+   for (int i = getNumBalls() - 1; i >= 0; --i)
+   {
+      double px = x[i], py = y[i], dx = vx[i], dy = vy[i];
+      const double r = radius[i];
+      const double duration = std::min(numSamples, samplesLeftAlive[i]);
+      int &sounding = samplesLeftSounding[i];
+
+      double t = 0.0;
+      for (int bounce = 0; t < duration && bounce < MAX_BOUNCES_PER_BLOCK; ++bounce)
+      {
+         // Broad phase over the box swept by the rest of the move, then the earliest edge the
+         // ball's rim reaches while heading towards it
+         const double remaining = duration - t;
+         const double endX = px + dx * remaining, endY = py + dy * remaining;
+         const GeoUtils::BBox swept{std::min(px, endX) - r, std::min(py, endY) - r, std::max(px, endX) + r, std::max(py, endY) + r};
+
+         double hitTime = remaining, normalX = 0.0, normalY = 0.0;
+         bool hit = false;
+         auto test = [&](const GeoUtils::Edge &edge)
+         {
+            // Distance and speed along the edge's normal, both scaled by the edge's length,
+            // with the normal facing the ball. A ball right on the line has just bounced off
+            // it, so the normal faces the way it is leaving.
+            const double ex = edge.v.x - edge.u.x, ey = edge.v.y - edge.u.y;
+            const double offset = ex * (py - edge.u.y) - ey * (px - edge.u.x);
+            const double speed = ex * dy - ey * dx;
+            const double facing = offset > 0.0 || (offset == 0.0 && speed > 0.0) ? 1.0 : -1.0;
+            if (facing * speed >= 0.0)
+               return; // moving away from the line, or along it
+
+            // A ball already overlapping the edge bounces off it straight away
+            const double length = std::sqrt(ex * ex + ey * ey);
+            const double time = std::max((facing * offset - r * length) / (-facing * speed), 0.0);
+            if (time >= hitTime)
+               return;
+
+            const double along = (px + dx * time - edge.u.x) * ex + (py + dy * time - edge.u.y) * ey;
+            if (along < 0.0 || along > length * length)
+               return;
+
+            hitTime = time;
+            normalX = -facing * ey / length;
+            normalY = facing * ex / length;
+            hit = true;
+         };
+         edges.forEachEdgeNear(swept, test);
+
+         px += dx * hitTime;
+         py += dy * hitTime;
+         t += hitTime;
+         if (!hit)
+            break;
+
+         const double towards = dx * normalX + dy * normalY;
+         dx -= 2.0 * towards * normalX;
+         dy -= 2.0 * towards * normalY;
+
+         const int sample = std::min(static_cast<int>(t), numSamples - 1);
+         // A note still sounding is ended where the next one starts, so every note-on has its
+         // note-off
+         if (sounding >= 0)
+            emit(std::min(sounding, sample), note[i], 0.f, site[i]);
+         const double impactSpeed = -towards * sampleRate;
+         emit(sample, note[i], static_cast<float>(std::clamp(impactSpeed / FULL_VELOCITY_SPEED, 0.05, 1.0)), site[i]);
+         sounding = sample + noteSamples;
+      }
+
+      x[i] = px;
+      y[i] = py;
+      vx[i] = dx;
+      vy[i] = dy;
+
+      if (sounding >= 0 && sounding < numSamples)
+      {
+         emit(sounding, note[i], 0.f, site[i]);
+         sounding = -1;
+      }
+      else if (sounding >= 0)
+      {
+         sounding -= numSamples;
+      }
+
+      samplesLeftAlive[i] -= numSamples;
+      if (samplesLeftAlive[i] <= 0)
+      {
+         if (sounding >= 0)
+            emit(std::clamp(numSamples + samplesLeftAlive[i], 0, numSamples - 1), note[i], 0.f, site[i]);
+         retire(i);
+      }
+   }
+}
+
+// Moves the last ball into the retired one's place
+void BallPhysics::retire(int ball)
+{
+   for (auto *values : {&x, &y, &vx, &vy, &radius})
+   {
+      (*values)[ball] = values->back();
+      values->pop_back();
+   }
+   for (auto *values : {&note, &site, &samplesLeftAlive, &samplesLeftSounding})
+   {
+      (*values)[ball] = values->back();
+      values->pop_back();
+   }
+}
@@ -0,0 +1,59 @@
+#include "synth/ModMatrix.h"
+
+namespace
+{
+   constexpr double SMOOTHING_SECONDS = 0.05;
+
+   const char* const SOURCE_NAMES[ModMatrix::NUM_SOURCES] = {"Area", "Perimeter", "Neighbours", "Centre Distance", "Vertices"};
+   const char* const DESTINATION_NAMES[ModMatrix::NUM_DESTINATIONS] = {"Gain", "Cutoff", "Resonance"};
+}
+
+juce::String ModMatrix::getParameterID(int source, Destination destination) {
+   return "mod_" + juce::String(source) + "_" + juce::String(static_cast<int>(destination));
+}
+
+void ModMatrix::addParameters(juce::AudioProcessorValueTreeState::ParameterLayout& layout) {
+   for (int s = 0; s < NUM_SOURCES; s++) {
+      for (int d = 0; d < NUM_DESTINATIONS; d++) {
+         const auto destination = static_cast<Destination>(d);
+         layout.add(std::make_unique<juce::AudioParameterFloat>(
+            juce::ParameterID{getParameterID(s, destination), 1},
+            juce::String(SOURCE_NAMES[s]) + " > " + DESTINATION_NAMES[d],
+            juce::NormalisableRange<float>(-1.f, 1.f), 0.f));
+      }
+   }
+}
+
+void ModMatrix::attach(juce::AudioProcessorValueTreeState& apvts) {
+   for (int s = 0; s < NUM_SOURCES; s++) {
+      for (int d = 0; d < NUM_DESTINATIONS; d++) {
+         depths[static_cast<size_t>(s * NUM_DESTINATIONS + d)] = apvts.getRawParameterValue(getParameterID(s, static_cast<Destination>(d)));
+      }
+   }
+}
+
+void ModMatrix::prepareToPlay(double sampleRate) {
+   for (auto& value : smoothed) {
+      value.reset(sampleRate, SMOOTHING_SECONDS);
+   }
+}
+
+float ModMatrix::evaluate(Destination destination, const Sources& rowSources) const {
+   float target = 0.f;
+   for (int s = 0; s < NUM_SOURCES; s++) {
+      if (const auto* depth = depths[static_cast<size_t>(s * NUM_DESTINATIONS + destination)]) {
+         target += depth->load(std::memory_order_relaxed) * rowSources[static_cast<size_t>(s)];
+      }
+   }
+   return juce::jlimit(-1.f, 1.f, target);
+}
+
+void ModMatrix::advance(int numSamples) {
+   for (int d = 0; d < NUM_DESTINATIONS; d++) {
+      // Once per block: the value a block starts with is held for all of it
+      auto& value = smoothed[static_cast<size_t>(d)];
+      value.setTargetValue(evaluate(static_cast<Destination>(d), sources));
+      values[static_cast<size_t>(d)] = value.getCurrentValue();
+      value.skip(numSamples);
+   }
+}
@@ -0,0 +1,120 @@
+#include "synth/VoiceEnvelopes.h"
+#include <cmath>
+
+namespace
+{
+   // A released voice below this level is silent and done
+   constexpr float SILENCE = 0.001f;
+
+   // Time for a stolen voice to glide most of the way to its new pitch
+   constexpr double GLIDE_SECONDS = 0.01;
+
+   // Per-sample factor that shrinks a distance to SILENCE of itself over seconds
+   float fallCoefficient(double seconds, double sampleRate) {
+      return static_cast<float>(std::exp(std::log(static_cast<double>(SILENCE)) / juce::jmax(1.0, seconds * sampleRate)));
+   }
+}
+
+void VoiceEnvelopes::prepare(double newSampleRate, int numVoices) {
+   sampleRate = newSampleRate;
+   const auto size = static_cast<size_t>(juce::jmax(0, numVoices));
+   stages.assign(size, Idle);
+   for (auto* values : {&velocities, &startLevels, &levels, &frequencies, &targetFrequencies}) {
+      values->assign(size, 0.f);
+   }
+   updateCoefficients();
+}
+
+void VoiceEnvelopes::setSettings(const Settings& newSettings) {
+   if (newSettings == settings) {
+      return;
+   }
+   settings = newSettings;
+   updateCoefficients();
+}
+
+void VoiceEnvelopes::updateCoefficients() {
+   attackStep = static_cast<float>(1.0 / juce::jmax(1.0, settings.attack * sampleRate));
+   decayCoefficient = fallCoefficient(settings.decay, sampleRate);
+   releaseCoefficient = fallCoefficient(settings.release, sampleRate);
+   glideCoefficient = fallCoefficient(GLIDE_SECONDS, sampleRate);
+}
+
+void VoiceEnvelopes::noteOn(int voice, float velocity) {
+   const auto v = static_cast<size_t>(voice);
+   stages[v] = Attack;
+   velocities[v] = velocity;
+}
+
+void VoiceEnvelopes::noteOff(int voice) {
+   const auto v = static_cast<size_t>(voice);
+   if (stages[v] != Idle) {
+      stages[v] = Release;
+   }
+}
+
+void VoiceEnvelopes::setPitch(int voice, float frequency, bool glide) {
+   const auto v = static_cast<size_t>(voice);
+   targetFrequencies[v] = frequency;
+   if (!glide) {
+      frequencies[v] = frequency;
+   }
+}
+
+void VoiceEnvelopes::advance(const int* voiceIds, size_t count, int numSamples) {
+   if (numSamples <= 0) {
+      return;
+   }
+
+   // Every voice in the same stage falls by the same factor over the step
+   const auto decayFactor = std::pow(decayCoefficient, static_cast<float>(numSamples));
+   const auto releaseFactor = std::pow(releaseCoefficient, static_cast<float>(numSamples));
+   const auto glideFactor = std::pow(glideCoefficient, static_cast<float>(numSamples));
+   const auto attackRise = attackStep * static_cast<float>(numSamples);
+
+   for (size_t i = 0; i < count; i++) {
+      const auto v = static_cast<size_t>(voiceIds[i]);
+      auto level = levels[v];
+      startLevels[v] = level;
+
+      const auto peak = velocities[v];
+      const auto sustainLevel = settings.sustain * peak;
+      switch (stages[v]) {
+         case Attack:
+            if (level + attackRise < peak) {
+               level += attackRise;
+               break;
+            }
+            // Reaches the peak part way through, and decays for the rest of the step
+            {
+               const auto rising = level < peak ? (peak - level) / attackStep : 0.f;
+               const auto from = juce::jmax(level, peak);
+               level = sustainLevel + (from - sustainLevel) * std::pow(decayCoefficient, static_cast<float>(numSamples) - rising);
+               stages[v] = Decay;
+            }
+            break;
+         case Decay:
+            level = sustainLevel + (level - sustainLevel) * decayFactor;
+            break;
+         case Release:
+            level *= releaseFactor;
+            if (level < SILENCE) {
+               level = 0.f;
+               stages[v] = Idle;
+            }
+            break;
+         case Idle:
+            level = 0.f;
+            break;
+      }
+      levels[v] = level;
+
+      // Close enough is exact, so a finished glide stops asking for the oscillator to retune
+      auto& frequency = frequencies[v];
+      const auto target = targetFrequencies[v];
+      frequency = target + (frequency - target) * glideFactor;
+      if (std::abs(frequency - target) < 0.01f) {
+         frequency = target;
+      }
+   }
+}
@@ -0,0 +1,161 @@
+#include "synth/VoiceFilters.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+   // Time for a voice's cutoff and resonance to get most of the way to a new setting
+   constexpr double SMOOTHING_SECONDS = 0.01;
+
+   enum LaneState
+   {
+      A1,
+      A2,
+      A3,
+      Ic1eq,
+      Ic2eq,
+      NUM_STATES
+   };
+}
+
+void VoiceFilters::prepare(double newSampleRate, int numVoices) {
+   constexpr size_t ALIGNMENT_FLOATS = 64 / sizeof(float);
+
+   sampleRate = newSampleRate;
+   smoothing = static_cast<float>(1.0 - std::exp(-SUB_BLOCK / (SMOOTHING_SECONDS * sampleRate)));
+   baseChanged = true;
+
+   const auto size = static_cast<size_t>(juce::jmax(0, numVoices));
+   for (auto* values : {&octaves, &targetOctaves, &resonances, &targetResonances, &a1, &a2, &a3, &ic1eq, &ic2eq}) {
+      values->assign(size, 0.f);
+   }
+
+   // Every buffer starts on a 64-byte boundary, which any register width divides
+   constexpr auto lanesPerGroup = static_cast<size_t>(LANES);
+   numGroups = (size + lanesPerGroup - 1) / lanesPerGroup;
+   const auto lanes = numGroups * lanesPerGroup;
+   const auto bufferSize = lanes * SUB_BLOCK;
+   storage.calloc(2 * bufferSize + NUM_STATES * lanes + ALIGNMENT_FLOATS);
+   const auto address = reinterpret_cast<std::uintptr_t>(storage.get());
+   input = reinterpret_cast<float*>((address + 63) & ~static_cast<std::uintptr_t>(63));
+   interleaved = input + bufferSize;
+   laneState = interleaved + bufferSize;
+
+   for (size_t v = 0; v < size; v++) {
+      updateCoefficients(v);
+   }
+}
+
+void VoiceFilters::setBase(float cutoff, float resonance) {
+   if (cutoff != baseCutoff || resonance != baseResonance) {
+      baseCutoff = cutoff;
+      baseResonance = resonance;
+      baseChanged = true;
+   }
+}
+
+void VoiceFilters::setModulation(int voice, float cutoffOctaves, float resonance) {
+   const auto v = static_cast<size_t>(voice);
+   targetOctaves[v] = cutoffOctaves;
+   targetResonances[v] = resonance;
+}
+
+void VoiceFilters::reset(int voice) {
+   const auto v = static_cast<size_t>(voice);
+   octaves[v] = targetOctaves[v];
+   resonances[v] = targetResonances[v];
+   ic1eq[v] = ic2eq[v] = 0.f;
+   updateCoefficients(v);
+}
+
+void VoiceFilters::updateCoefficients(const int* voiceIds, size_t count) {
+   for (size_t i = 0; i < count; i++) {
+      const auto v = static_cast<size_t>(voiceIds[i]);
+      if (!baseChanged && octaves[v] == targetOctaves[v] && resonances[v] == targetResonances[v]) {
+         continue;
+      }
+
+      // Close enough is exact, so a settled voice stops costing a tan() per sub-block
+      octaves[v] += (targetOctaves[v] - octaves[v]) * smoothing;
+      resonances[v] += (targetResonances[v] - resonances[v]) * smoothing;
+      if (std::abs(targetOctaves[v] - octaves[v]) < 0.001f && std::abs(targetResonances[v] - resonances[v]) < 0.001f) {
+         octaves[v] = targetOctaves[v];
+         resonances[v] = targetResonances[v];
+      }
+      updateCoefficients(v);
+   }
+   baseChanged = false;
+}
+
+// Topology-preserving transform of the two-integrator state-variable filter
+void VoiceFilters::updateCoefficients(size_t voice) {
+   const auto nyquist = static_cast<float>(0.45 * sampleRate);
+   const auto cutoff = juce::jlimit(20.f, nyquist, baseCutoff * std::exp2(octaves[voice]));
+   const auto resonance = juce::jlimit(0.f, 1.f, baseResonance + resonances[voice]);
+
+   const auto g = static_cast<float>(std::tan(juce::MathConstants<double>::pi * cutoff / sampleRate));
+   const auto k = 2.f - 1.96f * resonance; // 1 / Q
+   a1[voice] = 1.f / (1.f + g * (g + k));
+   a2[voice] = g * a1[voice];
+   a3[voice] = g * a2[voice];
+}
+
+void VoiceFilters::process(const int* voiceIds, size_t count, int numSamples, float* output) {
+   constexpr auto lanesPerGroup = static_cast<size_t>(LANES);
+   jassert(count <= numGroups * lanesPerGroup && numSamples <= SUB_BLOCK);
+   if (count == 0) {
+      return;
+   }
+
+   // Register g of state s sits at laneState + (s * groups + g) * LANES. Lanes past the last
+   // voice stay all zero, and so filter silence into silence.
+   const auto groups = (count + lanesPerGroup - 1) / lanesPerGroup;
+   const auto stride = groups * lanesPerGroup;
+   auto* state = laneState;
+   std::fill(state, state + NUM_STATES * stride, 0.f);
+   for (size_t slot = 0; slot < count; slot++) {
+      const auto v = static_cast<size_t>(voiceIds[slot]);
+      state[A1 * stride + slot] = a1[v];
+      state[A2 * stride + slot] = a2[v];
+      state[A3 * stride + slot] = a3[v];
+      state[Ic1eq * stride + slot] = ic1eq[v];
+      state[Ic2eq * stride + slot] = ic2eq[v];
+   }
+
+   // Rows to frames, so one load picks up a sample of a whole group
+   for (size_t slot = 0; slot < stride; slot++) {
+      auto* row = getInput(slot);
+      for (int s = 0; s < numSamples; s++) {
+         interleaved[static_cast<size_t>(s) * stride + slot] = row[s];
+      }
+      std::fill(row, row + numSamples, 0.f);
+   }
+
+   for (int s = 0; s < numSamples; s++) {
+      const auto* frame = interleaved + static_cast<size_t>(s) * stride;
+      auto sum = Lanes::expand(0.f);
+      for (size_t g = 0; g < groups; g++) {
+         const auto offset = g * lanesPerGroup;
+         const auto g1 = Lanes::fromRawArray(state + A1 * stride + offset);
+         const auto g2 = Lanes::fromRawArray(state + A2 * stride + offset);
+         const auto g3 = Lanes::fromRawArray(state + A3 * stride + offset);
+         const auto s1 = Lanes::fromRawArray(state + Ic1eq * stride + offset);
+         const auto s2 = Lanes::fromRawArray(state + Ic2eq * stride + offset);
+
+         const auto v3 = Lanes::fromRawArray(frame + offset) - s2;
+         const auto v1 = g1 * s1 + g2 * v3;
+         const auto v2 = s2 + g2 * s1 + g3 * v3;
+         (v1 + v1 - s1).copyToRawArray(state + Ic1eq * stride + offset);
+         (v2 + v2 - s2).copyToRawArray(state + Ic2eq * stride + offset);
+         sum = sum + v2;
+      }
+      output[s] += sum.sum();
+   }
+
+   for (size_t slot = 0; slot < count; slot++) {
+      const auto v = static_cast<size_t>(voiceIds[slot]);
+      ic1eq[v] = state[Ic1eq * stride + slot];
+      ic2eq[v] = state[Ic2eq * stride + slot];
+   }
+}
@@ -0,0 +1,87 @@
+#include "synth/WavetableBank.h"
+#include <cmath>
+#include <cstdint>
+
+Wavetable::Wavetable(const std::vector<float>& cycle)
+   : size{static_cast<int>(cycle.size())} {
+   constexpr size_t ALIGNMENT_FLOATS = 64 / sizeof(float);
+
+   const auto order = juce::roundToInt(std::log2(juce::jmax(size, 2)));
+   jassert(size >= 2 && (1 << order) == size);
+   numLevels = order;
+   stride = (static_cast<size_t>(size) + 1 + ALIGNMENT_FLOATS - 1) / ALIGNMENT_FLOATS * ALIGNMENT_FLOATS;
+
+   // Room to move the start up to the next boundary
+   storage.calloc(stride * static_cast<size_t>(numLevels) + ALIGNMENT_FLOATS);
+   const auto address = reinterpret_cast<std::uintptr_t>(storage.get());
+   samples = reinterpret_cast<float*>((address + 63) & ~static_cast<std::uintptr_t>(63));
+
+   // Each level is the spectrum of the cycle cut off above its highest harmonic. Bin h and
+   // its mirror size - h hold harmonic h; bin 0 is the DC offset.
+   juce::dsp::FFT fft(order);
+   std::vector<float> spectrum(2 * cycle.size(), 0.f);
+   std::copy(cycle.begin(), cycle.end(), spectrum.begin());
+   fft.performRealOnlyForwardTransform(spectrum.data());
+   spectrum[0] = spectrum[1] = 0.f;
+
+   std::vector<float> level(2 * cycle.size());
+   float peak = 0.f;
+   for (int k = 0; k < numLevels; k++) {
+      const auto highest = (size / 2) >> k;
+      level = spectrum;
+      if (highest + 1 < size - highest) {
+         std::fill(level.begin() + 2 * (highest + 1), level.begin() + 2 * (size - highest), 0.f);
+      }
+      fft.performRealOnlyInverseTransform(level.data());
+
+      auto* levelSamples = samples + static_cast<size_t>(k) * stride;
+      std::copy(level.begin(), level.begin() + size, levelSamples);
+      levelSamples[size] = levelSamples[0];
+
+      // Cutting harmonics off makes edges ring, so a level with fewer can peak higher
+      peak = juce::jmax(peak, juce::FloatVectorOperations::findMaximum(levelSamples, size));
+      peak = juce::jmax(peak, -juce::FloatVectorOperations::findMinimum(levelSamples, size));
+   }
+
+   if (peak > 0.f) {
+      juce::FloatVectorOperations::multiply(samples, 1.f / peak, static_cast<int>(stride) * numLevels);
+   }
+}
+
+int Wavetable::getLevelFor(float increment) const {
+   auto level = 0;
+   while (level + 1 < numLevels && static_cast<float>(1 << level) < increment) {
+      level++;
+   }
+   return level;
+}
+
+WavetableBank::WavetableBank() {
+   const auto twoPi = juce::MathConstants<float>::twoPi;
+   std::vector<float> cycle(TABLE_SIZE);
+
+   for (int shape = 0; shape < NUM_SHAPES; shape++) {
+      for (int i = 0; i < TABLE_SIZE; i++) {
+         const auto phase = static_cast<float>(i) / static_cast<float>(TABLE_SIZE);
+
+         switch (static_cast<Shape>(shape)) {
+            case Sine:
+               cycle[static_cast<size_t>(i)] = std::sin(twoPi * phase);
+               break;
+            case Triangle:
+               cycle[static_cast<size_t>(i)] = 1.f - 4.f * std::abs(phase - 0.5f);
+               break;
+            case Saw:
+               cycle[static_cast<size_t>(i)] = 2.f * phase - 1.f;
+               break;
+            case Square:
+               cycle[static_cast<size_t>(i)] = phase < 0.5f ? 1.f : -1.f;
+               break;
+            default:
+               break;
+         }
+      }
+
+      tables[static_cast<size_t>(shape)] = new Wavetable(cycle);
+   }
+}
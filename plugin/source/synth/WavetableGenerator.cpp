@@ -0,0 +1,127 @@
+#include "synth/WavetableGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+WavetableGenerator::WavetableGenerator() : juce::Thread("Voronoise wavetables") {
+   startThread(juce::Thread::Priority::low);
+   startTimer(500);
+}
+
+WavetableGenerator::~WavetableGenerator() {
+   stopTimer();
+   stopThread(2000);
+
+   delete pending.exchange(nullptr);
+   if (auto* unread = mailbox.exchange(nullptr)) {
+      unread->decReferenceCount();
+   }
+}
+
+void WavetableGenerator::requestCell(std::vector<GeoUtils::Point> polygon, const GeoUtils::Point& site, Profile profile) {
+   auto* request = new Request{std::move(polygon), site, profile};
+   delete pending.exchange(request, std::memory_order_acq_rel);
+   notify();
+}
+
+void WavetableGenerator::run() {
+   while (!threadShouldExit()) {
+      std::unique_ptr<Request> request(pending.exchange(nullptr, std::memory_order_acq_rel));
+      if (request == nullptr) {
+         wait(-1);
+         continue;
+      }
+
+      Wavetable::Ptr table = new Wavetable(traceCell(request->polygon, request->site, request->profile, WavetableBank::TABLE_SIZE));
+      {
+         const juce::ScopedLock lock(releaseLock);
+         releasePool.push_back(table);
+      }
+
+      // A table the audio thread never collected is simply dropped
+      table->incReferenceCount();
+      if (auto* unread = mailbox.exchange(table.get(), std::memory_order_acq_rel)) {
+         unread->decReferenceCount();
+      }
+   }
+}
+
+bool WavetableGenerator::pull(Wavetable::Ptr& latest) {
+   auto* incoming = mailbox.exchange(nullptr, std::memory_order_acq_rel);
+   if (incoming == nullptr) {
+      return false;
+   }
+
+   // The release pool still holds both tables, so neither reference change can free one here
+   latest = incoming;
+   incoming->decReferenceCount();
+   return true;
+}
+
+void WavetableGenerator::timerCallback() {
+   const juce::ScopedLock lock(releaseLock);
+   releasePool.erase(std::remove_if(releasePool.begin(), releasePool.end(), [](const Wavetable::Ptr& table) {
+                        return table->getReferenceCount() <= 1;
+                     }),
+                     releasePool.end());
+}
+
+std::vector<float> WavetableGenerator::traceCell(const std::vector<GeoUtils::Point>& polygon, const GeoUtils::Point& site,
+                                                 Profile profile, int size) {
+   std::vector<float> cycle(static_cast<size_t>(size), 0.f);
+   const auto n = polygon.size();
+   if (n < 3) {
+      return cycle;
+   }
+
+   if (profile == Profile::Radial) {
+      // Where a ray from the site first leaves the polygon, one ray per sample
+      for (int i = 0; i < size; i++) {
+         const auto angle = juce::MathConstants<double>::twoPi * i / size;
+         const auto dx = std::cos(angle), dy = std::sin(angle);
+         auto nearest = std::numeric_limits<double>::max();
+         for (size_t k = 0; k < n; k++) {
+            const auto& a = polygon[k];
+            const auto& b = polygon[(k + 1) % n];
+            const auto ex = b.x - a.x, ey = b.y - a.y;
+            const auto denominator = dx * ey - dy * ex;
+            if (denominator == 0.0) {
+               continue;
+            }
+
+            const auto t = ((a.x - site.x) * ey - (a.y - site.y) * ex) / denominator;
+            const auto u = ((a.x - site.x) * dy - (a.y - site.y) * dx) / denominator;
+            if (t > 0.0 && u >= 0.0 && u <= 1.0) {
+               nearest = std::min(nearest, t);
+            }
+         }
+         cycle[static_cast<size_t>(i)] = nearest == std::numeric_limits<double>::max() ? 0.f : static_cast<float>(nearest);
+      }
+      return cycle;
+   }
+
+   // Equal steps along the perimeter
+   std::vector<double> lengths(n + 1, 0.0);
+   for (size_t k = 0; k < n; k++) {
+      lengths[k + 1] = lengths[k] + polygon[k].getDistanceFrom(polygon[(k + 1) % n]);
+   }
+   if (lengths[n] <= 0.0) {
+      return cycle;
+   }
+
+   size_t k = 0;
+   for (int i = 0; i < size; i++) {
+      const auto along = lengths[n] * i / size;
+      while (k + 1 < n && lengths[k + 1] <= along) {
+         k++;
+      }
+
+      const auto& a = polygon[k];
+      const auto& b = polygon[(k + 1) % n];
+      const auto segment = lengths[k + 1] - lengths[k];
+      const auto fraction = segment > 0.0 ? (along - lengths[k]) / segment : 0.0;
+      cycle[static_cast<size_t>(i)] = static_cast<float>(a.x + (b.x - a.x) * fraction - site.x);
+   }
+   return cycle;
+}
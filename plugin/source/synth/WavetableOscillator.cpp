@@ -1,38 +1,93 @@
 #include "synth/WavetableOscillator.h"
+#include <algorithm>
 #include <cmath>
 
-WavetableOscillator::WavetableOscillator(std::vector<float> waveTable, 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VORONOISE_SSE2 1
+#endif
+
+WavetableOscillator::WavetableOscillator(const Wavetable& waveTable, 
    double sampleRate)
-      : waveTable{std::move(waveTable)},
-         sampleRate{sampleRate} {}
+      : waveTable{&waveTable},
+         samples{waveTable.getSamples()},
+         sampleRate{sampleRate} {
+   selectLevel();
+}
 
 void WavetableOscillator::setFrequency(float frequency) {
-   indexIncrement = frequency * static_cast<float>(waveTable.size())
-                     / static_cast<float>(sampleRate);
+   constexpr auto CYCLE = 4294967296.0; // 2^32
+
+   const auto cycles = juce::jlimit(0.0, 0.5, static_cast<double>(frequency) / sampleRate);
+   phaseIncrement = static_cast<uint32_t>(cycles * CYCLE);
+   selectLevel();
 }
 
-float WavetableOscillator::getSample() {
-   const auto sample = interpolateLinearly();
-   index += indexIncrement;
-   index = std::fmod(index, static_cast<float>(waveTable.size()));
-   return sample;
+void WavetableOscillator::setWavetable(const Wavetable& newWaveTable) {
+   waveTable = &newWaveTable;
+   selectLevel();
+}
+
+// Higher notes read a level with fewer harmonics, so none of them pass the Nyquist frequency
+void WavetableOscillator::selectLevel() {
+   const auto size = waveTable->getSize();
+   indexShift = 32 - juce::roundToInt(std::log2(size));
+
+   const auto increment = static_cast<float>(phaseIncrement) * static_cast<float>(size) / 4294967296.f;
+   samples = waveTable->getSamples(waveTable->getLevelFor(increment));
 }
 
-float WavetableOscillator::interpolateLinearly() {
-   const auto truncatedIdx = static_cast<int>(index);
-   const auto nextIdx = (truncatedIdx + 1) % static_cast<int>(waveTable.size());
+// The table repeats its first sample at the end, so the next index never wraps
+void WavetableOscillator::renderBlock(float* output, int numSamples, float startGain, float endGain) {
+   if (numSamples <= 0) {
+      return;
+   }
 
-   const auto nextIdxWeight = index - static_cast<float>(truncatedIdx);
-   const auto truncatedIdxWeight = 1.f - nextIdxWeight;
+   const auto fractionMask = (uint32_t{1} << indexShift) - 1;
+   const auto fractionScale = 1.f / static_cast<float>(uint64_t{1} << indexShift);
+   const auto gainSlope = (endGain - startGain) / static_cast<float>(numSamples);
+   int s = 0;
 
-   return truncatedIdxWeight * waveTable[truncatedIdx] + nextIdxWeight * waveTable[nextIdx];
+#if VORONOISE_SSE2
+   // Four samples at a time, with four phases a step apart
+   const __m128i laneOffsets = _mm_set_epi32(static_cast<int>(3 * phaseIncrement), static_cast<int>(2 * phaseIncrement),
+                                             static_cast<int>(phaseIncrement), 0);
+   const __m128i blockIncrement = _mm_set1_epi32(static_cast<int>(4 * phaseIncrement));
+   const __m128i fractionMaskV = _mm_set1_epi32(static_cast<int>(fractionMask));
+   const __m128 fractionScaleV = _mm_set1_ps(fractionScale);
+   const __m128 blockSlope = _mm_set1_ps(4.f * gainSlope);
+   __m128 gains = _mm_add_ps(_mm_set1_ps(startGain), _mm_mul_ps(_mm_set1_ps(gainSlope), _mm_set_ps(4.f, 3.f, 2.f, 1.f)));
+
+   __m128i phases = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(phase)), laneOffsets);
+   alignas(16) uint32_t lanePhases[4];
+   for (; s + 4 <= numSamples; s += 4) {
+      _mm_store_si128(reinterpret_cast<__m128i*>(lanePhases), phases);
+      const auto i0 = lanePhases[0] >> indexShift, i1 = lanePhases[1] >> indexShift;
+      const auto i2 = lanePhases[2] >> indexShift, i3 = lanePhases[3] >> indexShift;
+      const __m128 current = _mm_set_ps(samples[i3], samples[i2], samples[i1], samples[i0]);
+      const __m128 next = _mm_set_ps(samples[i3 + 1], samples[i2 + 1], samples[i1 + 1], samples[i0 + 1]);
+      const __m128 fraction = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(phases, fractionMaskV)), fractionScaleV);
+      const __m128 value = _mm_add_ps(current, _mm_mul_ps(_mm_sub_ps(next, current), fraction));
+
+      _mm_storeu_ps(output + s, _mm_add_ps(_mm_loadu_ps(output + s), _mm_mul_ps(gains, value)));
+      phases = _mm_add_epi32(phases, blockIncrement);
+      gains = _mm_add_ps(gains, blockSlope);
+   }
+   phase += static_cast<uint32_t>(s) * phaseIncrement;
+#endif
+
+   for (; s < numSamples; s++) {
+      const auto index = phase >> indexShift;
+      const auto fraction = static_cast<float>(phase & fractionMask) * fractionScale;
+      const auto value = samples[index] + (samples[index + 1] - samples[index]) * fraction;
+
+      const auto gain = startGain + gainSlope * static_cast<float>(s + 1);
+      output[s] += gain * value;
+      phase += phaseIncrement;
+   }
 }
 
 void WavetableOscillator::stop() {
-   index = 0.f;
-   indexIncrement = 0.f;
+   phase = 0;
+   phaseIncrement = 0;
 }
-
-bool WavetableOscillator::isPlaying() {
-   return indexIncrement != 0.f;
-}
\ No newline at end of file
@@ -1,32 +1,61 @@
 #include "synth/WavetableSynth.h"
 
-std::vector<float> WavetableSynth::generateSineWavetable(int length) {
-   std::vector<float> sineWaveTable(length);
-
-   const auto PI = std::atanf(1.f) * 4;
-
-   for(int i = 0; i < length; i++) {
-      sineWaveTable[i] = std::sinf(2 * PI * static_cast<float>(i) / static_cast<float>(length));
+void WavetableSynth::initializeVoices(int polyphony) {
+   // Voices only point into the shared bank, which builds its tables once per process
+   const auto& waveTable = getWavetable();
+
+   voices.clear();
+   activeVoices.clear();
+   freeVoices.clear();
+   voices.reserve(static_cast<size_t>(polyphony));
+   activeVoices.reserve(static_cast<size_t>(polyphony));
+   freeVoices.reserve(static_cast<size_t>(polyphony));
+
+   // Popped from the back, so voice 0 is taken first
+   for(int i = 0; i < polyphony; i++) {
+      voices.push_back({WavetableOscillator(waveTable, sampleRate)});
+      freeVoices.push_back(polyphony - 1 - i);
    }
-
-   return sineWaveTable;
+   envelopes.prepare(sampleRate, polyphony);
+   filters.prepare(sampleRate, polyphony);
+   noteFilters.clear();
+   noteFilters.reserve(MAX_NOTE_FILTERS);
 }
 
-void WavetableSynth::initializeOscillators() {
-   constexpr auto OSCILLATORS_COUNT = 128;
+void WavetableSynth::prepareToPlay(double newSampleRate, int polyphony) {
+   sampleRate = newSampleRate;
+   notesStarted = 0;
 
-   const auto waveTable = generateSineWavetable(64);
+   initializeVoices(juce::jmax(1, polyphony));
+}
 
-   oscillators.clear();
-   for(int i = 0; i < OSCILLATORS_COUNT; i++) {
-      oscillators.emplace_back(waveTable, sampleRate);
+// "Cell" plays a sine until the first cell table arrives
+const Wavetable& WavetableSynth::getWavetable() const {
+   if (waveform == WavetableBank::NUM_SHAPES) {
+      return cellTable != nullptr ? *cellTable : bank->get(WavetableBank::Sine);
    }
+   return bank->get(static_cast<WavetableBank::Shape>(juce::jlimit(0, WavetableBank::NUM_SHAPES - 1, waveform)));
 }
 
-void WavetableSynth::prepareToPlay(double newSampleRate) {
-   sampleRate = newSampleRate;
+void WavetableSynth::switchWavetable() {
+   const auto& waveTable = getWavetable();
+   for (auto& voice : voices) {
+      voice.oscillator.setWavetable(waveTable);
+   }
+}
+
+void WavetableSynth::setWaveform(int shape) {
+   if (shape != waveform) {
+      waveform = shape;
+      switchWavetable();
+   }
+}
 
-   initializeOscillators();
+void WavetableSynth::setCellWavetable(Wavetable::Ptr table) {
+   cellTable = std::move(table);
+   if (waveform == WavetableBank::NUM_SHAPES) {
+      switchWavetable();
+   }
 }
 
 void WavetableSynth::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) {
@@ -37,53 +66,168 @@ void WavetableSynth::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBu
       const auto midiEventSample = static_cast<int>(midiEvent.getTimeStamp());
 
       render(buffer, currentSample, midiEventSample);
-      handleMidiEvent(midiEvent);
+      handleMidiEvent(midiEvent, midiEventSample);
 
       currentSample = midiEventSample;
    }
 
    render(buffer, currentSample, buffer.getNumSamples());
+   noteFilters.clear();
 }
 
 void WavetableSynth::render(juce::AudioBuffer<float>& buffer, int startSample, int endSample) {
-   auto* firstChannel = buffer.getWritePointer(0);
+   if (endSample <= startSample) {
+      return;
+   }
+
+   auto* output = buffer.getWritePointer(0) + startSample;
+   const auto numSamples = endSample - startSample;
+
+   // A sub-block at a time, so envelopes, glides and filter settings move at the same rate
+   // whatever the host's buffer size
+   for (int offset = 0; offset < numSamples; offset += VoiceFilters::SUB_BLOCK) {
+      const auto length = juce::jmin(VoiceFilters::SUB_BLOCK, numSamples - offset);
+      envelopes.advance(activeVoices.data(), activeVoices.size(), length);
+      filters.updateCoefficients(activeVoices.data(), activeVoices.size());
 
-   for (auto& oscillator: oscillators) {
-      if (oscillator.isPlaying()) {
-         for (int s = startSample; s < endSample; s++) {
-            firstChannel[s] += oscillator.getSample();
+      for (size_t slot = 0; slot < activeVoices.size(); slot++) {
+         const auto voiceId = activeVoices[slot];
+         auto& oscillator = voices[static_cast<size_t>(voiceId)].oscillator;
+
+         // The pitch is set at wherever the glide has got to by the end of the sub-block
+         if (envelopes.isGliding(voiceId)) {
+            oscillator.setFrequency(envelopes.getFrequency(voiceId));
          }
+         oscillator.renderBlock(filters.getInput(slot), length, envelopes.getStartLevel(voiceId), envelopes.getLevel(voiceId));
+      }
+      filters.process(activeVoices.data(), activeVoices.size(), length, output + offset);
+   }
+
+   // Backwards, so a voice that has faded out can be swapped with the last active one
+   for (auto a = activeVoices.size(); a-- > 0;) {
+      const auto voiceId = activeVoices[a];
+      auto& voice = voices[static_cast<size_t>(voiceId)];
+
+      if (envelopes.getStage(voiceId) == VoiceEnvelopes::Idle) {
+         voice.oscillator.stop();
+         voice.note = -1;
+         activeVoices[a] = activeVoices.back();
+         activeVoices.pop_back();
+         freeVoices.push_back(voiceId);
       }
    }
 
    for (int c = 1; c < buffer.getNumChannels(); c++) {
-      std::copy(firstChannel + startSample, firstChannel + endSample, 
-         buffer.getWritePointer(c) + startSample);
+      std::copy(output, output + numSamples, buffer.getWritePointer(c) + startSample);
    }
 }
 
-void WavetableSynth::handleMidiEvent(const juce::MidiMessage& midiEvent) {
+void WavetableSynth::handleMidiEvent(const juce::MidiMessage& midiEvent, int sample) {
    if (midiEvent.isNoteOn()) {
-      const auto oscillatorId = midiEvent.getNoteNumber();
-      const auto frequency = midiNoteNumberToFrequency(oscillatorId);
-      oscillators[oscillatorId].setFrequency(frequency);
+      startNote(midiEvent.getNoteNumber(), midiEvent.getFloatVelocity(), sample);
 
    } else if (midiEvent.isNoteOff()) {
-      const auto oscillatorId = midiEvent.getNoteNumber();
-      oscillators[oscillatorId].stop();
+      releaseNote(midiEvent.getNoteNumber());
 
    } else if (midiEvent.isAllNotesOff()) {
-      for (auto& oscillator : oscillators) {
-         oscillator.stop();
+      for (const auto voiceId : activeVoices) {
+         envelopes.noteOff(voiceId);
       }
    }
 
 }
 
+void WavetableSynth::startNote(int note, float velocity, int sample) {
+   const auto voiceId = takeVoice();
+   auto& voice = voices[static_cast<size_t>(voiceId)];
+
+   // A stolen voice keeps its phase and level and glides to the new pitch, so taking it over
+   // does not click
+   const auto stolen = voice.note >= 0;
+   envelopes.setPitch(voiceId, midiNoteNumberToFrequency(note), stolen);
+   envelopes.noteOn(voiceId, velocity);
+
+   // Two note-ons of one note at one sample take their offsets in the order they were set
+   auto cutoffOctaves = 0.f, resonance = 0.f;
+   for (auto& noteFilter : noteFilters) {
+      if (noteFilter.note == note && noteFilter.sample == sample) {
+         cutoffOctaves = noteFilter.cutoffOctaves;
+         resonance = noteFilter.resonance;
+         noteFilter.note = -1;
+         break;
+      }
+   }
+   filters.setModulation(voiceId, cutoffOctaves, resonance);
+   if (!stolen) {
+      voice.oscillator.setFrequency(envelopes.getFrequency(voiceId));
+      filters.reset(voiceId);
+   }
+   voice.note = note;
+   voice.startedAt = notesStarted++;
+}
+
+// Past the reserved room a note-on plays the base filter, rather than allocate here
+void WavetableSynth::setNoteFilter(int note, int sample, float cutoffOctaves, float resonance) {
+   if (note >= 0 && noteFilters.size() < MAX_NOTE_FILTERS) {
+      noteFilters.push_back({note, sample, cutoffOctaves, resonance});
+   }
+}
+
+WavetableSynth::VoiceInfo WavetableSynth::getActiveVoice(int index) const {
+   const auto voiceId = activeVoices[static_cast<size_t>(index)];
+   return {voices[static_cast<size_t>(voiceId)].note, envelopes.getStage(voiceId), envelopes.getLevel(voiceId)};
+}
+
+// A note played twice is ended once per note-off, oldest first
+void WavetableSynth::releaseNote(int note) {
+   auto oldest = -1;
+   for (const auto voiceId : activeVoices) {
+      const auto& voice = voices[static_cast<size_t>(voiceId)];
+      if (voice.note == note && envelopes.getStage(voiceId) != VoiceEnvelopes::Release
+          && (oldest < 0 || voice.startedAt < voices[static_cast<size_t>(oldest)].startedAt)) {
+         oldest = voiceId;
+      }
+   }
+
+   if (oldest >= 0) {
+      envelopes.noteOff(oldest);
+   }
+}
+
+// A free voice if there is one, otherwise the active voice chosen by voiceStealing; voices
+// already released go first
+int WavetableSynth::takeVoice() {
+   if (!freeVoices.empty()) {
+      const auto voiceId = freeVoices.back();
+      freeVoices.pop_back();
+      activeVoices.push_back(voiceId);
+      return voiceId;
+   }
+
+   auto isBetterVictim = [this](int candidate, int victim) {
+      const auto candidateReleased = envelopes.getStage(candidate) == VoiceEnvelopes::Release;
+      if (candidateReleased != (envelopes.getStage(victim) == VoiceEnvelopes::Release)) {
+         return candidateReleased;
+      }
+      if (voiceStealing == VoiceStealing::Quietest && envelopes.getLevel(candidate) != envelopes.getLevel(victim)) {
+         return envelopes.getLevel(candidate) < envelopes.getLevel(victim);
+      }
+      return voices[static_cast<size_t>(candidate)].startedAt < voices[static_cast<size_t>(victim)].startedAt;
+   };
+
+   auto victimId = activeVoices.front();
+   for (const auto voiceId : activeVoices) {
+      if (isBetterVictim(voiceId, victimId)) {
+         victimId = voiceId;
+      }
+   }
+   return victimId;
+}
+
 float WavetableSynth::midiNoteNumberToFrequency(int midiNoteNumber) {
    constexpr auto A4_FREQEUNCY = 440.f;
    constexpr auto A4_NOTE_NUMBER = 69.f;
    constexpr auto SEMITONES_IN_AN_OCTAVE = 12.f;
 
    return A4_FREQEUNCY * std::powf(2.f, (midiNoteNumber - A4_NOTE_NUMBER) / SEMITONES_IN_AN_OCTAVE);
-}
\ No newline at end of file
+}
@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <random>
+
+#include "primitives/BallPhysics.h"
+#include "geometry/Delaunay.h"
+#include "geometry/Voronoi.h"
+#include "geometry/CellLocator.h"
+
+namespace
+{
+   const GeoUtils::BBox box = {0, 0, 100, 100};
+
+   void addWalls(std::vector<GeoUtils::Edge> &edges)
+   {
+      edges.push_back({{box.minX, box.minY}, {box.maxX, box.minY}});
+      edges.push_back({{box.maxX, box.minY}, {box.maxX, box.maxY}});
+      edges.push_back({{box.maxX, box.maxY}, {box.minX, box.maxY}});
+      edges.push_back({{box.minX, box.maxY}, {box.minX, box.minY}});
+   }
+
+   // Notes with the block's start added to their sample
+   std::vector<BallNote> run(BallPhysics &physics, const GeoUtils::EdgeGrid &grid, int blocks, int blockSize)
+   {
+      std::vector<BallNote> all, notes;
+      notes.reserve(64);
+      for (int b = 0; b < blocks; ++b)
+      {
+         notes.clear();
+         physics.process(blockSize, grid, notes);
+         for (auto note : notes)
+         {
+            EXPECT_GE(note.sample, 0);
+            EXPECT_LT(note.sample, blockSize);
+            note.sample += b * blockSize;
+            all.push_back(note);
+         }
+      }
+      return all;
+   }
+}
+
+TEST(BallPhysicsTest, BouncesOffWallsOnTheRightSample)
+{
+   std::vector<GeoUtils::Edge> edges;
+   addWalls(edges);
+   GeoUtils::EdgeGrid grid;
+   grid.build(edges, box);
+
+   // 125 units per second at 1 kHz: the rim reaches x = 100 after 360 samples, and x = 0
+   // another 720 samples later
+   BallPhysics physics;
+   physics.prepare(1000.0, 4);
+   Ball ball;
+   ball.position = {50, 50};
+   ball.radius = 5.f;
+   ball.velocity = 125.f;
+   ball.frequency = 440.f;
+   ASSERT_TRUE(physics.launch(ball));
+
+   auto notes = run(physics, grid, 21, 64);
+   ASSERT_EQ(notes.size(), 4u);
+   EXPECT_EQ(notes[0].sample, 360);
+   EXPECT_EQ(notes[0].note, 69);
+   EXPECT_GT(notes[0].velocity, 0.f);
+   EXPECT_EQ(notes[1].sample, 560); // ends after 0.2 s
+   EXPECT_EQ(notes[1].velocity, 0.f);
+   EXPECT_EQ(notes[2].sample, 1080);
+   EXPECT_EQ(notes[3].sample, 1280);
+   EXPECT_EQ(physics.getPosition(0).x, 5.0 + 0.125 * (21 * 64 - 1080));
+}
+
+TEST(BallPhysicsTest, BallsStayInTheirCells)
+{
+   std::mt19937 rng(12);
+   std::uniform_real_distribution<double> dist(0.0, 100.0);
+   std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+   std::vector<GeoUtils::Point> sites;
+   for (int i = 0; i < 200; ++i)
+      sites.push_back({dist(rng), dist(rng)});
+
+   auto mesh = Delaunay::triangulateMesh(sites);
+   auto edges = Voronoi::getEdges(mesh, box);
+   addWalls(edges);
+   GeoUtils::EdgeGrid grid;
+   grid.build(edges, box);
+   Voronoi::CellLocator locator;
+   locator.build(mesh);
+
+   // Every ball starts on a site, so it is inside that site's cell and should never leave it
+   BallPhysics physics;
+   physics.prepare(48000.0, static_cast<int>(sites.size()));
+   std::vector<int> cells;
+   for (const auto &site : sites)
+   {
+      Ball ball;
+      ball.position = site;
+      ball.radius = 0.1f;
+      ball.angle = angle(rng);
+      ball.velocity = 500.f;
+      ball.timeLeftAlive = 100.f;
+      ASSERT_TRUE(physics.launch(ball));
+      cells.push_back(locator.findCell(site));
+   }
+
+   std::vector<BallNote> notes;
+   notes.reserve(4096);
+   size_t impacts = 0;
+   for (int b = 0; b < 500; ++b)
+   {
+      notes.clear();
+      physics.process(64, grid, notes);
+      impacts += notes.size();
+      for (int i = 0; i < physics.getNumBalls(); ++i)
+         ASSERT_EQ(locator.findCell(physics.getPosition(i), cells[i]), cells[i]) << "ball " << i << ", block " << b;
+   }
+   EXPECT_GT(impacts, 0u);
+}
+
+TEST(BallPhysicsTest, RetiredBallsEndTheirNotes)
+{
+   std::vector<GeoUtils::Edge> edges;
+   addWalls(edges);
+   GeoUtils::EdgeGrid grid;
+   grid.build(edges, box);
+
+   BallPhysics physics;
+   physics.prepare(1000.0, 2);
+   Ball ball;
+   ball.position = {95, 50};
+   ball.radius = 0.f;
+   ball.velocity = 125.f;
+   ball.timeLeftAlive = 0.1f;
+   ball.site = 7;
+   ASSERT_TRUE(physics.launch(ball));
+   ASSERT_TRUE(physics.launch(ball));
+   EXPECT_FALSE(physics.launch(ball)); // full
+
+   // Both hit the wall at sample 40 and are gone after 100 samples, before their notes would end
+   auto notes = run(physics, grid, 4, 32);
+   EXPECT_EQ(physics.getNumBalls(), 0);
+   ASSERT_EQ(notes.size(), 4u);
+   int on = 0, off = 0;
+   for (const auto &note : notes)
+   {
+      EXPECT_EQ(note.site, 7);
+      if (note.velocity > 0.f)
+      {
+         EXPECT_EQ(note.sample, 40);
+         ++on;
+      }
+      else
+      {
+         EXPECT_EQ(note.sample, 100);
+         ++off;
+      }
+   }
+   EXPECT_EQ(on, 2);
+   EXPECT_EQ(off, 2);
+}
+
+TEST(BallPhysicsTest, FastBouncesEndEachNoteBeforeTheNext)
+{
+   // A 10-unit box crossed at 100 units per second: a bounce every 0.1 s, twice as often as
+   // a note lasts
+   const GeoUtils::BBox small = {0, 0, 10, 10};
+   std::vector<GeoUtils::Edge> edges = {{{small.minX, small.minY}, {small.maxX, small.minY}},
+                                        {{small.maxX, small.minY}, {small.maxX, small.maxY}},
+                                        {{small.maxX, small.maxY}, {small.minX, small.maxY}},
+                                        {{small.minX, small.maxY}, {small.minX, small.minY}}};
+   GeoUtils::EdgeGrid grid;
+   grid.build(edges, small);
+
+   BallPhysics physics;
+   physics.prepare(1000.0, 1);
+   Ball ball;
+   ball.position = {5, 5};
+   ball.radius = 0.f;
+   ball.velocity = 100.f;
+   ball.timeLeftAlive = 2.f;
+   ASSERT_TRUE(physics.launch(ball));
+
+   auto notes = run(physics, grid, 40, 64);
+   EXPECT_EQ(physics.getNumBalls(), 0);
+
+   // Strictly alternating, starting with a note-on
+   int on = 0, off = 0;
+   for (const auto &note : notes)
+   {
+      if (note.velocity > 0.f)
+      {
+         EXPECT_EQ(on, off) << "note-on at " << note.sample << " while a note is sounding";
+         ++on;
+      }
+      else
+      {
+         EXPECT_EQ(on, off + 1) << "note-off at " << note.sample << " with no note sounding";
+         ++off;
+      }
+   }
+   EXPECT_GT(on, 10);
+   EXPECT_EQ(on, off);
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+#include "geometry/Utils.h"
+#include "geometry/Delaunay.h"
+
+namespace
+{
+   std::vector<GeoUtils::Point> randomPoints(size_t count, unsigned seed)
+   {
+      std::mt19937 rng(seed);
+      std::uniform_real_distribution<double> dist(0.0, 1000.0);
+      std::vector<GeoUtils::Point> points;
+      for (size_t i = 0; i < count; ++i)
+         points.push_back({dist(rng), dist(rng)});
+      return points;
+   }
+
+   double signedArea(const GeoUtils::Triangle &t)
+   {
+      return (t.b.x - t.a.x) * (t.c.y - t.a.y) - (t.b.y - t.a.y) * (t.c.x - t.a.x);
+   }
+
+   void expectEmptyCircumcircles(const std::vector<GeoUtils::Triangle> &tris, const std::vector<GeoUtils::Point> &points)
+   {
+      for (const auto &t : tris)
+      {
+         auto cc = Delaunay::getCircumcircle(t);
+         ASSERT_TRUE(cc.valid);
+         for (const auto &p : points)
+         {
+            double distSq = (p.x - cc.center.x) * (p.x - cc.center.x) + (p.y - cc.center.y) * (p.y - cc.center.y);
+            EXPECT_GE(distSq, cc.radiusSq * (1.0 - 1e-9));
+         }
+      }
+   }
+}
+
+TEST(DelaunayTest, RandomPointsSatisfyEmptyCircumcircle)
+{
+   auto points = randomPoints(500, 1);
+   auto tris = Delaunay::triangulate(points);
+
+   // Euler: a triangulation of n points with h on the hull has 2n - h - 2 triangles
+   ASSERT_GT(tris.size(), points.size());
+   ASSERT_LT(tris.size(), 2 * points.size());
+
+   for (const auto &t : tris)
+      EXPECT_GT(signedArea(t), 0.0);
+
+   expectEmptyCircumcircles(tris, points);
+}
+
+TEST(DelaunayTest, TriangulationCoversConvexHull)
+{
+   auto points = randomPoints(300, 2);
+   auto tris = Delaunay::triangulate(points);
+
+   double area = 0.0;
+   for (const auto &t : tris)
+      area += signedArea(t) / 2.0;
+
+   // Monotone chain hull area
+   auto sorted = points;
+   std::sort(sorted.begin(), sorted.end(), GeoUtils::PointComparator());
+   std::vector<GeoUtils::Point> hull(2 * sorted.size());
+   size_t k = 0;
+   auto cross = [](const GeoUtils::Point &o, const GeoUtils::Point &a, const GeoUtils::Point &b)
+   { return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x); };
+   for (size_t i = 0; i < sorted.size(); ++i)
+   {
+      while (k >= 2 && cross(hull[k - 2], hull[k - 1], sorted[i]) <= 0)
+         --k;
+      hull[k++] = sorted[i];
+   }
+   for (size_t i = sorted.size() - 1, t = k + 1; i > 0; --i)
+   {
+      while (k >= t && cross(hull[k - 2], hull[k - 1], sorted[i - 1]) <= 0)
+         --k;
+      hull[k++] = sorted[i - 1];
+   }
+   double hullArea = 0.0;
+   for (size_t i = 0; i + 1 < k; ++i)
+      hullArea += (hull[i].x * hull[i + 1].y - hull[i + 1].x * hull[i].y) / 2.0;
+
+   EXPECT_NEAR(area, hullArea, hullArea * 1e-9);
+}
+
+TEST(DelaunayTest, DuplicatePointsAreIgnored)
+{
+   std::vector<GeoUtils::Point> points = {{0, 0}, {10, 0}, {0, 10}, {10, 0}, {0, 0}, {10, 10}};
+   auto tris = Delaunay::triangulate(points);
+   EXPECT_EQ(tris.size(), 2u);
+}
+
+TEST(DelaunayTest, CollinearInputProducesNoTriangles)
+{
+   std::vector<GeoUtils::Point> points = {{0, 0}, {1, 1}, {2, 2}, {3, 3}};
+   EXPECT_TRUE(Delaunay::triangulate(points).empty());
+}
+
+TEST(DelaunayTest, MeshHalfedgesAreSymmetric)
+{
+   auto points = randomPoints(200, 3);
+   auto mesh = Delaunay::triangulateMesh(points);
+
+   ASSERT_EQ(mesh.triangles.size(), mesh.halfedges.size());
+   size_t hullEdges = 0;
+   for (size_t e = 0; e < mesh.halfedges.size(); ++e)
+   {
+      int twin = mesh.halfedges[e];
+      if (twin == GeoUtils::NO_HALFEDGE)
+      {
+         ++hullEdges;
+         continue;
+      }
+      EXPECT_EQ(mesh.halfedges[twin], static_cast<int>(e));
+      EXPECT_EQ(mesh.triangles[twin], mesh.triangles[GeoUtils::nextHalfedge(static_cast<int>(e))]);
+      EXPECT_EQ(mesh.triangles[GeoUtils::nextHalfedge(twin)], mesh.triangles[e]);
+   }
+   EXPECT_EQ(mesh.numTriangles(), 2 * points.size() - hullEdges - 2);
+
+   auto rebuilt = GeoUtils::Mesh::fromTriangles(mesh.toTriangles());
+   EXPECT_EQ(rebuilt.numTriangles(), mesh.numTriangles());
+   EXPECT_EQ(std::count(rebuilt.halfedges.begin(), rebuilt.halfedges.end(), GeoUtils::NO_HALFEDGE), static_cast<long>(hullEdges));
+}
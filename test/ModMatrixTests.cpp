@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <JuceHeader.h>
+
+#include "synth/ModMatrix.h"
+
+namespace
+{
+   // Just enough of a processor to own the depth parameters
+   struct ParameterHost : juce::AudioProcessor
+   {
+      ParameterHost() : apvts(*this, nullptr, "Test", makeLayout()) {}
+
+      static juce::AudioProcessorValueTreeState::ParameterLayout makeLayout()
+      {
+         juce::AudioProcessorValueTreeState::ParameterLayout layout;
+         ModMatrix::addParameters(layout);
+         return layout;
+      }
+
+      void setDepth(int source, ModMatrix::Destination destination, float depth)
+      {
+         apvts.getRawParameterValue(ModMatrix::getParameterID(source, destination))->store(depth);
+      }
+
+      const juce::String getName() const override { return "Test"; }
+      void prepareToPlay(double, int) override {}
+      void releaseResources() override {}
+      void processBlock(juce::AudioBuffer<float> &, juce::MidiBuffer &) override {}
+      double getTailLengthSeconds() const override { return 0.0; }
+      bool acceptsMidi() const override { return false; }
+      bool producesMidi() const override { return false; }
+      juce::AudioProcessorEditor *createEditor() override { return nullptr; }
+      bool hasEditor() const override { return false; }
+      int getNumPrograms() override { return 1; }
+      int getCurrentProgram() override { return 0; }
+      void setCurrentProgram(int) override {}
+      const juce::String getProgramName(int) override { return {}; }
+      void changeProgramName(int, const juce::String &) override {}
+      void getStateInformation(juce::MemoryBlock &) override {}
+      void setStateInformation(const void *, int) override {}
+
+      juce::AudioProcessorValueTreeState apvts;
+   };
+
+   struct ModMatrixTest : ::testing::Test
+   {
+      ModMatrixTest() { matrix.attach(host.apvts); }
+
+      juce::ScopedJuceInitialiser_GUI juce;
+      ParameterHost host;
+      ModMatrix matrix;
+   };
+}
+
+TEST_F(ModMatrixTest, SumsSourcesScaledByTheirDepths)
+{
+   host.setDepth(0, ModMatrix::Gain, 0.5f);
+   host.setDepth(1, ModMatrix::Gain, -0.25f);
+   host.setDepth(2, ModMatrix::Gain, 0.25f);
+
+   matrix.prepareToPlay(1000.0);
+   matrix.setSources({0.8f, 0.4f, 0.3f, 1.f, 1.f});
+   for (int block = 0; block < 10; ++block)
+      matrix.advance(64);
+   EXPECT_NEAR(matrix.getValue(ModMatrix::Gain), 0.375f, 1e-6f);
+}
+
+TEST_F(ModMatrixTest, ClampsEachDestinationToUnitRange)
+{
+   for (int s = 0; s < ModMatrix::NUM_SOURCES; ++s)
+      host.setDepth(s, ModMatrix::Gain, 1.f);
+
+   ModMatrix::Sources sources;
+   sources.fill(1.f);
+
+   // The smoothed value heads for the clamped sum, not the raw one
+   matrix.prepareToPlay(1000.0);
+   matrix.setSources(sources);
+   for (int block = 0; block < 10; ++block)
+      matrix.advance(64);
+   EXPECT_EQ(matrix.getValue(ModMatrix::Gain), 1.f);
+
+   for (int s = 0; s < ModMatrix::NUM_SOURCES; ++s)
+      host.setDepth(s, ModMatrix::Gain, -1.f);
+   for (int block = 0; block < 10; ++block)
+      matrix.advance(64);
+   EXPECT_EQ(matrix.getValue(ModMatrix::Gain), -1.f);
+}
+
+TEST_F(ModMatrixTest, SmoothsChangesOverSeveralBlocks)
+{
+   host.setDepth(0, ModMatrix::Gain, 1.f);
+   matrix.prepareToPlay(1000.0);
+   matrix.setSources({1.f, 0.f, 0.f, 0.f, 0.f});
+
+   // Each block plays the value it starts with, so the first is still at rest
+   matrix.advance(10);
+   EXPECT_EQ(matrix.getValue(ModMatrix::Gain), 0.f);
+   matrix.advance(10);
+   EXPECT_GT(matrix.getValue(ModMatrix::Gain), 0.f);
+   EXPECT_LT(matrix.getValue(ModMatrix::Gain), 1.f);
+}
+
+TEST_F(ModMatrixTest, EvaluatesARowAtOnce)
+{
+   host.setDepth(0, ModMatrix::FilterCutoff, 0.5f);
+   host.setDepth(1, ModMatrix::FilterCutoff, -0.25f);
+   host.setDepth(2, ModMatrix::Gain, 1.f);
+
+   // No smoothing, so a note's filter follows its own cell straight away
+   const ModMatrix::Sources sources{0.8f, 0.4f, 0.3f, 1.f, 1.f};
+   EXPECT_NEAR(matrix.evaluate(ModMatrix::FilterCutoff, sources), 0.3f, 1e-6f);
+   EXPECT_NEAR(matrix.evaluate(ModMatrix::Gain, sources), 0.3f, 1e-6f);
+   EXPECT_EQ(matrix.evaluate(ModMatrix::FilterResonance, sources), 0.f);
+
+   for (int s = 0; s < ModMatrix::NUM_SOURCES; ++s)
+      host.setDepth(s, ModMatrix::FilterResonance, -1.f);
+   EXPECT_EQ(matrix.evaluate(ModMatrix::FilterResonance, sources), -1.f);
+}
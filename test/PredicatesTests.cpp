@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+#include "geometry/Predicates.h"
+#include "geometry/Delaunay.h"
+
+TEST(PredicatesTest, Orient2dIsExactNearALine)
+{
+   // Points within a few ulps of the line y = x; the naive determinant gets many signs wrong here
+   const double ulp = std::ldexp(1.0, -53);
+   for (int i = 0; i < 64; ++i)
+   {
+      for (int j = 0; j < 64; ++j)
+      {
+         GeoUtils::Point p{0.5 + i * ulp, 0.5 + j * ulp};
+         double expected = (p.y > p.x) - (p.y < p.x);
+         double o = GeoUtils::orient2d(p, {12.0, 12.0}, {24.0, 24.0});
+         ASSERT_EQ((o > 0.0) - (o < 0.0), expected) << i << ", " << j;
+      }
+   }
+}
+
+TEST(PredicatesTest, IncircleIsExactForCocircularPoints)
+{
+   // A unit square far from the origin, so the translated coordinates lose all low bits
+   const double x = 1e8 + 0.5, y = -3e7 + 0.25;
+   GeoUtils::Point a{x, y}, b{x + 1.0, y}, c{x + 1.0, y + 1.0};
+
+   EXPECT_EQ(GeoUtils::incircle(a, b, c, {x, y + 1.0}), 0.0);
+   EXPECT_GT(GeoUtils::incircle(a, b, c, {x, std::nextafter(y + 1.0, y)}), 0.0);
+   EXPECT_LT(GeoUtils::incircle(a, b, c, {x, std::nextafter(y + 1.0, y + 2.0)}), 0.0);
+}
+
+TEST(PredicatesTest, GridTriangulatesWithoutRepairs)
+{
+   // Every grid cell is co-circular; each must be split into exactly two triangles
+   std::vector<GeoUtils::Point> points;
+   for (int i = 0; i < 40; ++i)
+   {
+      for (int j = 0; j < 40; ++j)
+         points.push_back({0.1 * i, 0.1 * j});
+   }
+   points.push_back(points[17]);
+
+   auto mesh = Delaunay::triangulateMesh(points);
+   EXPECT_EQ(mesh.numTriangles(), 2u * 39 * 39);
+   for (size_t t = 0; t < mesh.numTriangles(); ++t)
+   {
+      auto tri = mesh.getTriangle(t);
+      ASSERT_GT(GeoUtils::orient2d(tri.a, tri.b, tri.c), 0.0);
+   }
+}
@@ -0,0 +1,303 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <random>
+#include <set>
+#include <algorithm>
+
+#include "geometry/Triangulation.h"
+#include "geometry/Predicates.h"
+
+namespace
+{
+   double orient(const GeoUtils::Point &a, const GeoUtils::Point &b, const GeoUtils::Point &c)
+   {
+      return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+   }
+
+   // Checks twins, orientation and the empty circumcircle property against every site
+   void expectDelaunay(const Delaunay::Triangulation &triangulation, const std::vector<int> &sites)
+   {
+      auto mesh = triangulation.getMesh();
+      for (size_t e = 0; e < mesh.halfedges.size(); ++e)
+      {
+         int twin = mesh.halfedges[e];
+         if (twin != GeoUtils::NO_HALFEDGE)
+         {
+            ASSERT_EQ(mesh.halfedges[twin], static_cast<int>(e));
+         }
+      }
+
+      for (size_t t = 0; t < mesh.numTriangles(); ++t)
+      {
+         auto tri = mesh.getTriangle(t);
+         ASSERT_GT(orient(tri.a, tri.b, tri.c), 0.0);
+
+         for (int s : sites)
+         {
+            const auto &d = triangulation.getSite(s);
+            double adx = tri.a.x - d.x, ady = tri.a.y - d.y;
+            double bdx = tri.b.x - d.x, bdy = tri.b.y - d.y;
+            double cdx = tri.c.x - d.x, cdy = tri.c.y - d.y;
+            double det = (adx * adx + ady * ady) * (bdx * cdy - cdx * bdy) +
+                         (bdx * bdx + bdy * bdy) * (cdx * ady - adx * cdy) +
+                         (cdx * cdx + cdy * cdy) * (adx * bdy - bdx * ady);
+            ASSERT_LE(det, 1e-6);
+         }
+      }
+   }
+
+   // Checks every interior edge with the exact incircle test, which is enough for the whole
+   // mesh to be Delaunay, and that the triangles cover the hull of all sites
+   void expectLocallyDelaunay(const GeoUtils::Mesh &mesh, size_t numSites)
+   {
+      size_t hullEdges = 0;
+      for (size_t e = 0; e < mesh.halfedges.size(); ++e)
+      {
+         int twin = mesh.halfedges[e];
+         if (twin == GeoUtils::NO_HALFEDGE)
+         {
+            ++hullEdges;
+            continue;
+         }
+         ASSERT_EQ(mesh.halfedges[twin], static_cast<int>(e));
+
+         auto tri = mesh.getTriangle(e / 3);
+         const auto &opposite = mesh.points[mesh.triangles[GeoUtils::prevHalfedge(twin)]];
+         ASSERT_LE(GeoUtils::incircle(tri.a, tri.b, tri.c, opposite), 0.0);
+      }
+
+      for (size_t t = 0; t < mesh.numTriangles(); ++t)
+      {
+         auto tri = mesh.getTriangle(t);
+         ASSERT_GT(GeoUtils::orient2d(tri.a, tri.b, tri.c), 0.0);
+      }
+      EXPECT_EQ(mesh.numTriangles(), 2 * numSites - 2 - hullEdges);
+   }
+
+   std::vector<std::set<int>> neighbours(const Delaunay::Triangulation &triangulation)
+   {
+      auto mesh = triangulation.getMesh();
+      std::vector<std::set<int>> result(mesh.points.size());
+      for (size_t e = 0; e < mesh.triangles.size(); ++e)
+      {
+         int u = mesh.triangles[e], v = mesh.triangles[GeoUtils::nextHalfedge(static_cast<int>(e))];
+         result[u].insert(v);
+         result[v].insert(u);
+      }
+      return result;
+   }
+}
+
+TEST(TriangulationTest, IncrementalEditsKeepTheMeshDelaunay)
+{
+   std::mt19937 rng(7);
+   std::uniform_real_distribution<double> dist(0.0, 400.0);
+
+   Delaunay::Triangulation triangulation;
+   std::vector<int> sites;
+
+   for (int step = 0; step < 600; ++step)
+   {
+      auto before = neighbours(triangulation);
+      int action = sites.size() < 20 ? 0 : static_cast<int>(rng() % 3);
+      int moved = -1;
+
+      if (action == 0)
+      {
+         sites.push_back(triangulation.insertSite({dist(rng), dist(rng)}));
+      }
+      else if (action == 1)
+      {
+         size_t i = rng() % sites.size();
+         ASSERT_TRUE(triangulation.removeSite(sites[i]));
+         sites.erase(sites.begin() + static_cast<long>(i));
+      }
+      else
+      {
+         moved = sites[rng() % sites.size()];
+         auto p = triangulation.getSite(moved);
+         double radius = (step % 2) ? 5.0 : 200.0;
+         std::uniform_real_distribution<double> jitter(-radius, radius);
+         GeoUtils::Point target{std::clamp(p.x + jitter(rng), 0.0, 400.0), std::clamp(p.y + jitter(rng), 0.0, 400.0)};
+         ASSERT_TRUE(triangulation.moveSite(moved, target));
+         if (target == p)
+            moved = -1;
+      }
+
+      ASSERT_EQ(triangulation.getNumSites(), sites.size());
+      expectDelaunay(triangulation, sites);
+
+      // Any site whose neighbourhood differs, or that neighbours the moved site, must be reported
+      auto after = neighbours(triangulation);
+      const auto &changed = triangulation.getChangedSites();
+      std::set<int> reported(changed.begin(), changed.end());
+      for (int s : sites)
+      {
+         bool differs = s >= static_cast<int>(before.size()) || before[s] != after[s];
+         if (moved >= 0 && after[s].count(moved))
+            differs = true;
+         if (differs)
+         {
+            EXPECT_TRUE(reported.count(s)) << "site " << s << " at step " << step << " action " << action;
+         }
+      }
+   }
+}
+
+TEST(TriangulationTest, MovingManySitesAtOnceKeepsTheMeshDelaunay)
+{
+   std::mt19937 rng(9);
+   std::uniform_real_distribution<double> dist(0.0, 400.0);
+
+   Delaunay::Triangulation triangulation;
+   std::vector<int> sites;
+   for (int i = 0; i < 300; ++i)
+      sites.push_back(triangulation.insertSite({dist(rng), dist(rng)}));
+
+   // Small steps, as in a relaxation, mostly keep every triangle the right way round; every
+   // tenth step is large enough to turn some over
+   std::vector<GeoUtils::Point> targets(sites.size());
+   for (int step = 0; step < 40; ++step)
+   {
+      auto before = neighbours(triangulation);
+      double radius = step % 10 == 9 ? 50.0 : 0.5;
+      std::uniform_real_distribution<double> jitter(-radius, radius);
+      for (size_t i = 0; i < sites.size(); ++i)
+      {
+         auto p = triangulation.getSite(sites[i]);
+         targets[i] = {p.x + jitter(rng), p.y + jitter(rng)};
+      }
+      triangulation.moveSites(sites.data(), targets.data(), sites.size());
+
+      for (size_t i = 0; i < sites.size(); ++i)
+         ASSERT_EQ(triangulation.getSite(sites[i]), targets[i]);
+      expectDelaunay(triangulation, sites);
+
+      auto after = neighbours(triangulation);
+      const auto &changed = triangulation.getChangedSites();
+      std::set<int> reported(changed.begin(), changed.end());
+      for (int s : sites)
+      {
+         if (before[s] != after[s])
+         {
+            EXPECT_TRUE(reported.count(s)) << "site " << s << " at step " << step;
+         }
+      }
+   }
+}
+
+TEST(TriangulationTest, DegenerateSitesJoinOnceTheyCan)
+{
+   Delaunay::Triangulation triangulation;
+   int a = triangulation.insertSite({0, 0});
+   triangulation.insertSite({10, 0});
+   triangulation.insertSite({20, 0});
+   EXPECT_EQ(triangulation.getMesh().numTriangles(), 0u);
+
+   int top = triangulation.insertSite({10, 10});
+   EXPECT_EQ(triangulation.getMesh().numTriangles(), 2u);
+
+   int duplicate = triangulation.insertSite({10, 10});
+   EXPECT_EQ(triangulation.getMesh().numTriangles(), 2u);
+
+   ASSERT_TRUE(triangulation.removeSite(top));
+   EXPECT_EQ(triangulation.getMesh().numTriangles(), 2u);
+
+   ASSERT_TRUE(triangulation.removeSite(duplicate));
+   EXPECT_EQ(triangulation.getMesh().numTriangles(), 0u);
+
+   ASSERT_TRUE(triangulation.moveSite(a, {0, 5}));
+   EXPECT_EQ(triangulation.getMesh().numTriangles(), 1u);
+}
+
+TEST(TriangulationTest, MovingDegenerateSitesAtOnceFallsBackSafely)
+{
+   // Collinear sites have no triangles, so the batch hands every move to the one-at-a-time path
+   Delaunay::Triangulation triangulation;
+   std::vector<int> sites;
+   for (int i = 0; i < 40; ++i)
+      sites.push_back(triangulation.insertSite({10.0 * i, 0.0}));
+
+   std::vector<GeoUtils::Point> targets(sites.size());
+   for (size_t i = 0; i < sites.size(); ++i)
+      targets[i] = {10.0 * static_cast<double>(i) + 5.0, 0.0};
+   triangulation.moveSites(sites.data(), targets.data(), sites.size());
+   for (size_t i = 0; i < sites.size(); ++i)
+      ASSERT_EQ(triangulation.getSite(sites[i]), targets[i]);
+   EXPECT_EQ(triangulation.getMesh().numTriangles(), 0u);
+
+   // Duplicates of mesh sites wait to join, and moving them apart lets them in
+   for (int i = 0; i < 20; ++i)
+      sites.push_back(triangulation.insertSite({10.0 * i + 5.0, 0.0}));
+   sites.push_back(triangulation.insertSite({200.0, 100.0}));
+   targets.resize(sites.size());
+   for (size_t i = 0; i < sites.size(); ++i)
+   {
+      const auto p = triangulation.getSite(sites[i]);
+      targets[i] = i >= 40 && i < 60 ? GeoUtils::Point{p.x, -50.0 - static_cast<double>(i)} : GeoUtils::Point{p.x + 1.0, p.y};
+   }
+   triangulation.moveSites(sites.data(), targets.data(), sites.size());
+   for (size_t i = 0; i < sites.size(); ++i)
+      ASSERT_EQ(triangulation.getSite(sites[i]), targets[i]);
+   expectDelaunay(triangulation, sites);
+   expectLocallyDelaunay(triangulation.getMesh(), sites.size());
+}
+
+TEST(TriangulationTest, MeshCarriesCircumcenters)
+{
+   std::mt19937 rng(11);
+   std::uniform_real_distribution<double> dist(0.0, 400.0);
+   std::vector<GeoUtils::Point> points;
+   for (int i = 0; i < 300; ++i)
+      points.push_back({dist(rng), dist(rng)});
+
+   Delaunay::Triangulation triangulation(points);
+   triangulation.moveSite(5, {200.0, 200.0});
+   auto mesh = triangulation.getMesh();
+   ASSERT_EQ(mesh.circumcenters.size(), mesh.numTriangles());
+
+   for (size_t t = 0; t < mesh.numTriangles(); ++t)
+   {
+      auto tri = mesh.getTriangle(t);
+      const auto &centre = mesh.circumcenters[t];
+      double ra = centre.getDistanceFrom(tri.a);
+      EXPECT_NEAR(centre.getDistanceFrom(tri.b), ra, 1e-6 * (1.0 + ra));
+      EXPECT_NEAR(centre.getDistanceFrom(tri.c), ra, 1e-6 * (1.0 + ra));
+   }
+}
+
+TEST(TriangulationTest, SplitBuildDoesNotDependOnThreadCount)
+{
+   std::mt19937 rng(17);
+   std::uniform_real_distribution<double> dist(0.0, 1000.0);
+   std::vector<GeoUtils::Point> points;
+   for (int i = 0; i < 24000; ++i)
+      points.push_back({dist(rng), dist(rng)});
+
+   // A square grid past the random sites puts a seam through collinear and co-circular sites
+   for (int i = 0; i < 60; ++i)
+   {
+      for (int j = 0; j < 60; ++j)
+         points.push_back({1000.0 + 5.0 * i, 5.0 * j});
+   }
+
+   auto reference = Delaunay::Triangulation(points).getMesh();
+   expectLocallyDelaunay(reference, points.size());
+
+   for (int threads : {1, 2, 3, 8})
+   {
+      GeoUtils::TaskPool pool(threads);
+      auto mesh = Delaunay::Triangulation(points, &pool).getMesh();
+      EXPECT_EQ(mesh.triangles, reference.triangles) << threads << " threads";
+      EXPECT_EQ(mesh.halfedges, reference.halfedges) << threads << " threads";
+   }
+
+   // The stitched mesh stays editable
+   Delaunay::Triangulation triangulation(points);
+   for (int step = 0; step < 200; ++step)
+   {
+      int site = static_cast<int>(rng() % points.size());
+      ASSERT_TRUE(triangulation.moveSite(site, {dist(rng), dist(rng)}));
+   }
+   expectLocallyDelaunay(triangulation.getMesh(), points.size());
+}
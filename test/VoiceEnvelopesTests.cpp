@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+
+#include "synth/VoiceEnvelopes.h"
+
+namespace
+{
+   // A millisecond a sample keeps the times easy to count in samples
+   constexpr double sampleRate = 1000.0;
+
+   struct VoiceEnvelopesTest : ::testing::Test
+   {
+      VoiceEnvelopesTest()
+      {
+         envelopes.prepare(sampleRate, 1);
+         envelopes.setSettings({0.1f, 0.1f, 0.5f, 0.1f});
+      }
+
+      void advance(int samples, int step = 10)
+      {
+         for (; samples > 0; samples -= step)
+            envelopes.advance(&voice, 1, std::min(samples, step));
+      }
+
+      VoiceEnvelopes envelopes;
+      int voice = 0;
+   };
+}
+
+TEST_F(VoiceEnvelopesTest, AttackRisesLinearlyToTheVelocity)
+{
+   envelopes.noteOn(voice, 0.75f);
+   for (int step = 1; step < 8; ++step)
+   {
+      advance(10);
+      EXPECT_EQ(envelopes.getStage(voice), VoiceEnvelopes::Attack);
+      EXPECT_NEAR(envelopes.getLevel(voice), 0.1f * step, 1e-5f);
+      EXPECT_NEAR(envelopes.getStartLevel(voice), 0.1f * (step - 1), 1e-5f);
+   }
+
+   // 100 ms to full scale, so a velocity of 0.75 peaks after 75 and decays for 5
+   advance(10);
+   EXPECT_EQ(envelopes.getStage(voice), VoiceEnvelopes::Decay);
+   EXPECT_NEAR(envelopes.getLevel(voice), 0.375f + 0.375f * std::pow(0.001f, 5.f / 100.f), 1e-5f);
+}
+
+TEST_F(VoiceEnvelopesTest, DecayFallsTowardsTheSustainLevel)
+{
+   envelopes.noteOn(voice, 0.8f);
+   advance(90);
+   ASSERT_EQ(envelopes.getStage(voice), VoiceEnvelopes::Decay);
+   const float distance = envelopes.getLevel(voice) - 0.4f;
+   ASSERT_GT(distance, 0.f);
+
+   // The decay time takes the distance to the sustain level down by 60 dB
+   advance(100);
+   EXPECT_NEAR(envelopes.getLevel(voice), 0.4f + distance * 0.001f, 1e-5f);
+   advance(1000);
+   EXPECT_EQ(envelopes.getStage(voice), VoiceEnvelopes::Decay);
+   EXPECT_NEAR(envelopes.getLevel(voice), 0.4f, 1e-5f);
+}
+
+TEST_F(VoiceEnvelopesTest, AttackOvershootingThePeakDecaysForTheRestOfTheStep)
+{
+   envelopes.noteOn(voice, 1.f);
+   advance(90);
+
+   // Peaks 10 samples into a 20-sample step, then decays for the other 10
+   envelopes.advance(&voice, 1, 20);
+   const float decayed = 0.5f + 0.5f * std::pow(0.001f, 10.f / 100.f);
+   EXPECT_EQ(envelopes.getStage(voice), VoiceEnvelopes::Decay);
+   EXPECT_NEAR(envelopes.getLevel(voice), decayed, 1e-5f);
+}
+
+TEST_F(VoiceEnvelopesTest, ReleaseFallsToIdle)
+{
+   envelopes.noteOn(voice, 1.f);
+   advance(1000);
+   envelopes.noteOff(voice);
+   EXPECT_EQ(envelopes.getStage(voice), VoiceEnvelopes::Release);
+
+   advance(50);
+   EXPECT_EQ(envelopes.getStage(voice), VoiceEnvelopes::Release);
+   EXPECT_NEAR(envelopes.getLevel(voice), 0.5f * std::sqrt(0.001f), 1e-5f);
+
+   // Below -60 dB of full scale is silence
+   advance(50);
+   EXPECT_EQ(envelopes.getStage(voice), VoiceEnvelopes::Idle);
+   EXPECT_EQ(envelopes.getLevel(voice), 0.f);
+
+   envelopes.noteOff(voice);
+   EXPECT_EQ(envelopes.getStage(voice), VoiceEnvelopes::Idle);
+}
+
+TEST_F(VoiceEnvelopesTest, NoteOnStartsTheAttackFromTheCurrentLevel)
+{
+   envelopes.noteOn(voice, 1.f);
+   advance(1000);
+   envelopes.noteOff(voice);
+   advance(20);
+   const float released = envelopes.getLevel(voice);
+   ASSERT_GT(released, 0.f);
+
+   envelopes.noteOn(voice, 1.f);
+   EXPECT_EQ(envelopes.getStage(voice), VoiceEnvelopes::Attack);
+   EXPECT_EQ(envelopes.getLevel(voice), released);
+   advance(10);
+   EXPECT_NEAR(envelopes.getLevel(voice), released + 0.1f, 1e-5f);
+}
+
+TEST_F(VoiceEnvelopesTest, GlidesOnlyWhenAsked)
+{
+   envelopes.setPitch(voice, 100.f, false);
+   EXPECT_EQ(envelopes.getFrequency(voice), 100.f);
+   EXPECT_FALSE(envelopes.isGliding(voice));
+
+   envelopes.setPitch(voice, 200.f, true);
+   EXPECT_EQ(envelopes.getFrequency(voice), 100.f);
+   EXPECT_TRUE(envelopes.isGliding(voice));
+
+   // 10 ms takes the distance down by 60 dB, and a little longer lands on the target
+   advance(10);
+   EXPECT_NEAR(envelopes.getFrequency(voice), 200.f - 0.1f, 1e-3f);
+   advance(10);
+   EXPECT_EQ(envelopes.getFrequency(voice), 200.f);
+   EXPECT_FALSE(envelopes.isGliding(voice));
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "synth/VoiceFilters.h"
+
+namespace
+{
+   constexpr double sampleRate = 48000.0;
+   constexpr float baseCutoff = 1000.f;
+   constexpr float baseResonance = 0.3f;
+
+   // The same TPT state-variable lowpass, one voice and one sample at a time
+   struct ScalarSvf
+   {
+      ScalarSvf(float cutoffOctaves, float resonance)
+      {
+         const float cutoff = std::clamp(baseCutoff * std::exp2(cutoffOctaves), 20.f, static_cast<float>(0.45 * sampleRate));
+         const float r = std::clamp(baseResonance + resonance, 0.f, 1.f);
+         const float g = static_cast<float>(std::tan(juce::MathConstants<double>::pi * cutoff / sampleRate));
+         const float k = 2.f - 1.96f * r;
+         a1 = 1.f / (1.f + g * (g + k));
+         a2 = g * a1;
+         a3 = g * a2;
+      }
+
+      float process(float x)
+      {
+         const float v3 = x - ic2eq;
+         const float v1 = a1 * ic1eq + a2 * v3;
+         const float v2 = ic2eq + a2 * ic1eq + a3 * v3;
+         ic1eq = 2.f * v1 - ic1eq;
+         ic2eq = 2.f * v2 - ic2eq;
+         return v2;
+      }
+
+      float a1, a2, a3;
+      float ic1eq = 0.f, ic2eq = 0.f;
+   };
+}
+
+TEST(VoiceFiltersTest, MatchesAScalarFilterPerVoice)
+{
+   // Five voices fill no whole number of registers, and take the slots in a shifting order
+   constexpr int numVoices = 8;
+   std::vector<int> voiceIds{5, 0, 3, 6, 2};
+   const float octaves[numVoices] = {-2.f, 0.f, 1.5f, -1.f, 0.f, 2.5f, 3.f, 0.f};
+   const float resonances[numVoices] = {0.f, 0.f, 0.6f, 0.2f, 0.f, -0.3f, 0.7f, 0.f};
+
+   VoiceFilters filters;
+   filters.prepare(sampleRate, numVoices);
+   filters.setBase(baseCutoff, baseResonance);
+   std::vector<ScalarSvf> reference;
+   for (int v = 0; v < numVoices; ++v)
+   {
+      filters.setModulation(v, octaves[v], resonances[v]);
+      filters.reset(v);
+      reference.emplace_back(octaves[v], resonances[v]);
+   }
+
+   std::mt19937 random(1);
+   std::uniform_real_distribution<float> noise(-1.f, 1.f);
+   for (int subBlock = 0; subBlock < 40; ++subBlock)
+   {
+      // The last sub-blocks are short, then silent to hear the filters ring out
+      const int numSamples = subBlock < 30 ? VoiceFilters::SUB_BLOCK : 17;
+      const bool silent = subBlock >= 35;
+      std::rotate(voiceIds.begin(), voiceIds.begin() + 1, voiceIds.end());
+
+      std::vector<float> expected(VoiceFilters::SUB_BLOCK, 0.f);
+      filters.updateCoefficients(voiceIds.data(), voiceIds.size());
+      for (size_t slot = 0; slot < voiceIds.size(); ++slot)
+      {
+         float *input = filters.getInput(slot);
+         for (int s = 0; s < numSamples; ++s)
+         {
+            const float x = silent ? 0.f : noise(random);
+            if (!silent)
+               input[s] = x;
+            expected[static_cast<size_t>(s)] += reference[static_cast<size_t>(voiceIds[slot])].process(x);
+         }
+      }
+
+      std::vector<float> output(VoiceFilters::SUB_BLOCK, 0.5f);
+      filters.process(voiceIds.data(), voiceIds.size(), numSamples, output.data());
+      for (int s = 0; s < numSamples; ++s)
+         ASSERT_NEAR(output[static_cast<size_t>(s)], 0.5f + expected[static_cast<size_t>(s)], 1e-4f) << "sub-block " << subBlock << ", sample " << s;
+      if (numSamples < VoiceFilters::SUB_BLOCK)
+      {
+         EXPECT_EQ(output[static_cast<size_t>(numSamples)], 0.5f);
+      }
+   }
+}
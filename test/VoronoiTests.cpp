@@ -6,10 +6,16 @@
 #include <iostream>
 #include <cmath>
 #include <iomanip>
+#include <random>
+#include <limits>
 
 #include "geometry/Utils.h"
 #include "geometry/Delaunay.h"
 #include "geometry/Voronoi.h"
+#include "geometry/TaskPool.h"
+#include "geometry/CellLocator.h"
+#include "geometry/EdgeGrid.h"
+#include "geometry/CellFeatures.h"
 
 void printPoint(const GeoUtils::Point &p)
 {
@@ -56,7 +62,13 @@ TEST(VoronoiConsistencyTest, EdgesFromGetEdgesMatchEdgesFromGetCells)
          continue;
       for (size_t i = 0; i < vertices.size(); ++i)
       {
-         edges_from_cells.insert({vertices[i], vertices[(i + 1) % vertices.size()]});
+         // getEdges only returns Voronoi edges, not the stretches of box boundary that close cells
+         const auto &u = vertices[i];
+         const auto &v = vertices[(i + 1) % vertices.size()];
+         bool on_box = (u.x == bbox.minX && v.x == bbox.minX) || (u.x == bbox.maxX && v.x == bbox.maxX) ||
+                       (u.y == bbox.minY && v.y == bbox.minY) || (u.y == bbox.maxY && v.y == bbox.maxY);
+         if (!on_box)
+            edges_from_cells.insert({u, v});
       }
    }
 
@@ -81,5 +93,369 @@ TEST(VoronoiConsistencyTest, EdgesFromGetEdgesMatchEdgesFromGetCells)
    std::cout << "\n--- End of Log ---\n"
              << std::endl;
 
-   ASSERT_EQ(direct_edges_set, edges_from_cells);
+   // Edges and cells are clipped separately, so endpoints are compared with Edge's tolerance
+   ASSERT_EQ(direct_edges_set.size(), edges_from_cells.size());
+   for (const auto &edge : direct_edges_set)
+   {
+      EXPECT_TRUE(std::any_of(edges_from_cells.begin(), edges_from_cells.end(), [&](const GeoUtils::Edge &other)
+                              { return other == edge; }));
+   }
+}
+
+
+TEST(VoronoiDiagramTest, CellsTileTheBoxAndContainTheirSites)
+{
+   std::mt19937 rng(3);
+   std::uniform_real_distribution<double> dist(0.0, 100.0);
+   std::vector<GeoUtils::Point> sites;
+   for (int i = 0; i < 200; ++i)
+      sites.push_back({dist(rng), dist(rng)});
+   GeoUtils::BBox bbox = {0, 0, 100, 100};
+
+   auto diagram = Voronoi::getDiagram(Delaunay::triangulateMesh(sites), bbox);
+   ASSERT_EQ(diagram.numCells(), sites.size());
+
+   double area = 0.0;
+   for (size_t c = 0; c < diagram.numCells(); ++c)
+   {
+      const int n = diagram.cellSize(c);
+      ASSERT_GE(n, 3);
+      for (int k = 0; k < n; ++k)
+      {
+         const auto &a = diagram.cellVertex(c, k);
+         const auto &b = diagram.cellVertex(c, (k + 1) % n);
+         area += a.x * b.y - b.x * a.y;
+
+         // Counter-clockwise and convex, so the site is left of every edge
+         const auto &s = diagram.sites[c];
+         EXPECT_GE((b.x - a.x) * (s.y - a.y) - (b.y - a.y) * (s.x - a.x), -1e-9);
+      }
+   }
+   EXPECT_NEAR(area / 2.0, 100.0 * 100.0, 1e-6);
+}
+
+TEST(VoronoiDiagramTest, ThreadCountDoesNotChangeTheDiagram)
+{
+   std::mt19937 rng(5);
+   std::uniform_real_distribution<double> dist(-10.0, 110.0);
+   std::vector<GeoUtils::Point> sites;
+   for (int i = 0; i < 10000; ++i)
+      sites.push_back({dist(rng), dist(rng)});
+   GeoUtils::BBox bbox = {0, 0, 100, 100};
+
+   auto mesh = Delaunay::triangulateMesh(sites);
+   auto reference = Voronoi::getDiagram(mesh, bbox);
+   for (int threads : {1, 3, 8})
+   {
+      GeoUtils::TaskPool pool(threads);
+      auto diagram = Voronoi::getDiagram(mesh, bbox, &pool);
+      EXPECT_EQ(diagram.vertices, reference.vertices) << threads << " threads";
+      EXPECT_EQ(diagram.cellOffsets, reference.cellOffsets) << threads << " threads";
+      EXPECT_EQ(diagram.cellVertices, reference.cellVertices) << threads << " threads";
+   }
+}
+
+TEST(VoronoiDiagramTest, ReusedWorkspaceGivesTheSameDiagram)
+{
+   std::mt19937 rng(6);
+   std::uniform_real_distribution<double> dist(-10.0, 110.0);
+   GeoUtils::BBox bbox = {0, 0, 100, 100};
+
+   // Shrinking and growing inputs write over a diagram and workspace left by a different one
+   Voronoi::Diagram diagram;
+   Voronoi::Workspace workspace;
+   for (int numSites : {5000, 300, 9000, 0, 4000})
+   {
+      std::vector<GeoUtils::Point> sites;
+      for (int i = 0; i < numSites; ++i)
+         sites.push_back({dist(rng), dist(rng)});
+
+      auto mesh = Delaunay::triangulateMesh(sites);
+      auto reference = Voronoi::getDiagram(mesh, bbox);
+      Voronoi::getDiagram(mesh, bbox, diagram, workspace);
+      EXPECT_EQ(diagram.sites, reference.sites) << numSites << " sites";
+      EXPECT_EQ(diagram.vertices, reference.vertices) << numSites << " sites";
+      EXPECT_EQ(diagram.cellOffsets, reference.cellOffsets) << numSites << " sites";
+      EXPECT_EQ(diagram.cellVertices, reference.cellVertices) << numSites << " sites";
+   }
+}
+
+TEST(VoronoiDiagramTest, CentroidsMatchTheCellPolygons)
+{
+   std::mt19937 rng(8);
+   std::uniform_real_distribution<double> dist(0.0, 100.0);
+   std::vector<GeoUtils::Point> sites;
+   for (int i = 0; i < 500; ++i)
+      sites.push_back({dist(rng), dist(rng)});
+   GeoUtils::BBox bbox = {0, 0, 100, 100};
+
+   auto diagram = Voronoi::getDiagram(Delaunay::triangulateMesh(sites), bbox);
+   std::vector<GeoUtils::Point> centroids;
+   std::vector<double> areas;
+   Voronoi::getCentroids(diagram, centroids, areas);
+   ASSERT_EQ(centroids.size(), diagram.numCells());
+   ASSERT_EQ(areas.size(), diagram.numCells());
+
+   double total = 0.0;
+   for (size_t c = 0; c < diagram.numCells(); ++c)
+   {
+      // Shoelace over the polygon's own vertices
+      double area = 0.0, cx = 0.0, cy = 0.0;
+      const int n = diagram.cellSize(c);
+      for (int k = 0; k < n; ++k)
+      {
+         const auto &a = diagram.cellVertex(c, k);
+         const auto &b = diagram.cellVertex(c, (k + 1) % n);
+         const double cross = a.x * b.y - b.x * a.y;
+         area += cross;
+         cx += (a.x + b.x) * cross;
+         cy += (a.y + b.y) * cross;
+      }
+      area /= 2.0;
+      EXPECT_NEAR(areas[c], area, 1e-9 * bbox.maxX * bbox.maxY);
+      EXPECT_NEAR(centroids[c].x, cx / (6.0 * area), 1e-6);
+      EXPECT_NEAR(centroids[c].y, cy / (6.0 * area), 1e-6);
+      total += areas[c];
+   }
+   EXPECT_NEAR(total, 100.0 * 100.0, 1e-6);
+
+   // Sites on a regular grid are the centroids of their square cells
+   sites.clear();
+   for (int i = 0; i < 10; ++i)
+   {
+      for (int j = 0; j < 10; ++j)
+         sites.push_back({5.0 + 10.0 * i, 5.0 + 10.0 * j});
+   }
+   diagram = Voronoi::getDiagram(Delaunay::triangulateMesh(sites), bbox);
+   Voronoi::getCentroids(diagram, centroids, areas);
+   for (size_t c = 0; c < diagram.numCells(); ++c)
+   {
+      EXPECT_NEAR(areas[c], 100.0, 1e-9);
+      EXPECT_NEAR(centroids[c].x, diagram.sites[c].x, 1e-9);
+      EXPECT_NEAR(centroids[c].y, diagram.sites[c].y, 1e-9);
+   }
+}
+
+TEST(CellFeaturesTest, RowsFollowCellSitesAndAreScaled)
+{
+   std::mt19937 rng(10);
+   std::uniform_real_distribution<double> dist(0.0, 100.0);
+   std::vector<GeoUtils::Point> sites;
+   for (int i = 0; i < 300; ++i)
+      sites.push_back({dist(rng), dist(rng)});
+   GeoUtils::BBox bbox = {0, 0, 100, 100};
+
+   auto mesh = Delaunay::triangulateMesh(sites);
+   auto diagram = Voronoi::getDiagram(mesh, bbox);
+   std::vector<GeoUtils::Point> centroids;
+   std::vector<double> areas;
+   Voronoi::getCentroids(diagram, centroids, areas);
+
+   // Rows in reverse cell order, with one more row than there are cells
+   const size_t n = diagram.numCells();
+   std::vector<int> cellSites(n);
+   for (size_t c = 0; c < n; ++c)
+      cellSites[c] = static_cast<int>(n - c);
+
+   Voronoi::CellFeatures features;
+   features.build(mesh, diagram, bbox, cellSites, n + 1);
+   ASSERT_EQ(features.numRows(), n + 1);
+
+   std::vector<std::set<int>> neighbours(n);
+   for (size_t e = 0; e < mesh.triangles.size(); ++e)
+   {
+      const int u = mesh.triangles[e], v = mesh.triangles[GeoUtils::nextHalfedge(static_cast<int>(e))];
+      neighbours[u].insert(v);
+      neighbours[v].insert(u);
+   }
+
+   const double largestArea = *std::max_element(areas.begin(), areas.end());
+   size_t largestNeighbours = 0;
+   int largestVertices = 0;
+   for (size_t c = 0; c < n; ++c)
+   {
+      largestNeighbours = std::max(largestNeighbours, neighbours[c].size());
+      largestVertices = std::max(largestVertices, diagram.cellSize(c));
+   }
+
+   using Feature = Voronoi::CellFeatures::Feature;
+   std::array<float, Voronoi::CellFeatures::NUM_FEATURES> largest{};
+   for (size_t c = 0; c < n; ++c)
+   {
+      const size_t row = static_cast<size_t>(cellSites[c]);
+      EXPECT_NEAR(features.get(Feature::Area, row), areas[c] / largestArea, 1e-5);
+      EXPECT_NEAR(features.get(Feature::Neighbours, row), static_cast<double>(neighbours[c].size()) / largestNeighbours, 1e-6);
+      EXPECT_NEAR(features.get(Feature::Vertices, row), static_cast<double>(diagram.cellSize(c)) / largestVertices, 1e-6);
+      const double distance = sites[c].getDistanceFrom({50, 50}) / std::hypot(50.0, 50.0);
+      EXPECT_NEAR(features.get(Feature::CentreDistance, row), distance, 1e-6);
+
+      const auto rowValues = features.getRow(row);
+      for (int f = 0; f < Voronoi::CellFeatures::NUM_FEATURES; ++f)
+      {
+         EXPECT_GE(rowValues[f], 0.f);
+         EXPECT_LE(rowValues[f], 1.f);
+         largest[f] = std::max(largest[f], rowValues[f]);
+      }
+   }
+   EXPECT_FLOAT_EQ(largest[Feature::Perimeter], 1.f);
+
+   // Row 0 has no cell
+   for (float value : features.getRow(0))
+      EXPECT_EQ(value, 0.f);
+}
+
+TEST(CellLocatorTest, FindsTheNearestSite)
+{
+   std::mt19937 rng(7);
+   std::uniform_real_distribution<double> dist(0.0, 100.0);
+   std::uniform_real_distribution<double> query(-20.0, 120.0);
+   std::uniform_real_distribution<double> step(-1.0, 1.0);
+
+   auto nearestDistanceSq = [](const std::vector<GeoUtils::Point> &sites, const GeoUtils::Point &p)
+   {
+      double best = std::numeric_limits<double>::max();
+      for (const auto &site : sites)
+         best = std::min(best, site.getDistanceSquaredFrom(p));
+      return best;
+   };
+
+   // One locator rebuilt over differently sized inputs, including ones without a mesh
+   Voronoi::CellLocator locator;
+   for (int numSites : {2000, 50, 0, 1, 3000})
+   {
+      std::vector<GeoUtils::Point> sites;
+      for (int i = 0; i < numSites; ++i)
+         sites.push_back({dist(rng), dist(rng)});
+      locator.build(Delaunay::triangulateMesh(sites));
+
+      if (numSites == 0)
+      {
+         EXPECT_EQ(locator.findCell({50, 50}), -1);
+         continue;
+      }
+
+      // Ties between sites may go either way, so compare distances rather than indices
+      for (int i = 0; i < 500; ++i)
+      {
+         GeoUtils::Point p{query(rng), query(rng)};
+         int cell = locator.findCell(p);
+         ASSERT_GE(cell, 0);
+         ASSERT_LT(cell, numSites);
+         EXPECT_EQ(sites[cell].getDistanceSquaredFrom(p), nearestDistanceSq(sites, p)) << numSites << " sites";
+      }
+
+      // A point drifting about, each query starting from the last answer
+      GeoUtils::Point p{50, 50};
+      int cell = -1;
+      for (int i = 0; i < 500; ++i)
+      {
+         p.x += step(rng);
+         p.y += step(rng);
+         cell = locator.findCell(p, cell);
+         ASSERT_GE(cell, 0);
+         EXPECT_EQ(sites[cell].getDistanceSquaredFrom(p), nearestDistanceSq(sites, p)) << numSites << " sites";
+      }
+
+      // Out of range hints are ignored
+      EXPECT_EQ(locator.findCell(sites[0], numSites + 10), locator.findCell(sites[0]));
+   }
+
+   // Sites on one line have no mesh
+   std::vector<GeoUtils::Point> line = {{10, 10}, {20, 20}, {30, 30}, {40, 40}};
+   locator.build(Delaunay::triangulateMesh(line));
+   EXPECT_EQ(locator.findCell({31, 28}), 2);
+   EXPECT_EQ(locator.findCell({100, 0}, 0), 3);
+}
+
+TEST(EdgeGridTest, VisitsEachEdgeNearAQueryOnce)
+{
+   std::mt19937 rng(8);
+   std::uniform_real_distribution<double> dist(0.0, 100.0);
+   std::uniform_real_distribution<double> size(0.0, 20.0);
+   std::vector<GeoUtils::Point> sites;
+   for (int i = 0; i < 500; ++i)
+      sites.push_back({dist(rng), dist(rng)});
+   GeoUtils::BBox bbox = {0, 0, 100, 100};
+
+   auto edges = Voronoi::getEdges(Delaunay::triangulateMesh(sites), bbox);
+   edges.push_back({{-10, 50}, {110, 50}}); // across the whole grid and beyond it
+   GeoUtils::EdgeGrid grid;
+   grid.build(edges, bbox);
+   EXPECT_EQ(grid.numEdges(), edges.size());
+
+   for (int q = 0; q < 200; ++q)
+   {
+      GeoUtils::BBox box{dist(rng), dist(rng), 0, 0};
+      box.maxX = box.minX + size(rng);
+      box.maxY = box.minY + size(rng);
+
+      std::map<GeoUtils::Edge, int, Voronoi::EdgeComparator> visits;
+      grid.forEachEdgeNear(box, [&visits](const GeoUtils::Edge &edge)
+                           { ++visits[edge]; });
+      for (const auto &[edge, count] : visits)
+         EXPECT_EQ(count, 1);
+
+      // Every edge whose bounds meet the box is among them
+      for (const auto &edge : edges)
+      {
+         if (std::max(edge.u.x, edge.v.x) >= box.minX && std::min(edge.u.x, edge.v.x) <= box.maxX &&
+             std::max(edge.u.y, edge.v.y) >= box.minY && std::min(edge.u.y, edge.v.y) <= box.maxY)
+         {
+            EXPECT_TRUE(visits.contains(edge)) << "query " << q;
+         }
+      }
+   }
+}
+
+TEST(ClipTest, BatchKernelsMatchSingleClips)
+{
+   std::mt19937 rng(9);
+   std::uniform_real_distribution<double> dist(-50.0, 150.0);
+   GeoUtils::BBox bbox = {0, 0, 100, 100};
+
+   std::vector<GeoUtils::Edge> edges;
+   for (int i = 0; i < 1000; ++i)
+   {
+      GeoUtils::Point u{dist(rng), dist(rng)}, v{dist(rng), dist(rng)};
+      if (i % 4 == 1)
+         v.x = u.x; // vertical
+      else if (i % 4 == 2)
+         v.y = u.y; // horizontal
+      edges.push_back({u, v});
+   }
+
+   auto clipped = edges;
+   clipped.resize(GeoUtils::clipEdges(clipped.data(), clipped.size(), bbox));
+   size_t next = 0;
+   for (auto edge : edges)
+   {
+      if (!GeoUtils::clipEdge(edge, bbox))
+         continue;
+      ASSERT_LT(next, clipped.size());
+      EXPECT_TRUE(clipped[next++] == edge);
+   }
+   EXPECT_EQ(next, clipped.size());
+
+   // Triangles, mostly straddling the box
+   std::vector<GeoUtils::Point> vertices;
+   std::vector<int> offsets = {0};
+   for (int i = 0; i < 300; ++i)
+   {
+      for (int k = 0; k < 3; ++k)
+         vertices.push_back({dist(rng), dist(rng)});
+      offsets.push_back(static_cast<int>(vertices.size()));
+   }
+
+   std::pmr::vector<GeoUtils::Point> outVertices;
+   std::pmr::vector<int> outOffsets;
+   GeoUtils::ClipScratch scratch;
+   GeoUtils::clipPolygons(vertices, offsets, bbox, outVertices, outOffsets, scratch);
+   ASSERT_EQ(outOffsets.size(), offsets.size());
+   for (size_t i = 0; i + 1 < offsets.size(); ++i)
+   {
+      std::vector<GeoUtils::Point> polygon(vertices.begin() + offsets[i], vertices.begin() + offsets[i + 1]);
+      std::vector<GeoUtils::Point> expected = GeoUtils::clipPolygon(polygon, bbox);
+      std::vector<GeoUtils::Point> actual(outVertices.begin() + outOffsets[i], outVertices.begin() + outOffsets[i + 1]);
+      EXPECT_EQ(actual, expected) << "polygon " << i;
+   }
 }
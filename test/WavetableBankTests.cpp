@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "synth/WavetableBank.h"
+
+TEST(WavetableBankTest, SharedByEveryInstance)
+{
+   juce::SharedResourcePointer<WavetableBank> first, second;
+   for (int shape = 0; shape < WavetableBank::NUM_SHAPES; ++shape)
+   {
+      const auto s = static_cast<WavetableBank::Shape>(shape);
+      EXPECT_EQ(&first->get(s), &second->get(s));
+      EXPECT_EQ(first->get(s).getSize(), WavetableBank::TABLE_SIZE);
+   }
+}
+
+TEST(WavetableBankTest, LevelsAreAlignedAndRepeatTheirFirstSample)
+{
+   juce::SharedResourcePointer<WavetableBank> bank;
+   for (int shape = 0; shape < WavetableBank::NUM_SHAPES; ++shape)
+   {
+      const auto &table = bank->get(static_cast<WavetableBank::Shape>(shape));
+      for (int level = 0; level < table.getNumLevels(); ++level)
+      {
+         const float *samples = table.getSamples(level);
+         EXPECT_EQ(reinterpret_cast<std::uintptr_t>(samples) % 64, 0u) << "shape " << shape << ", level " << level;
+         EXPECT_EQ(samples[table.getSize()], samples[0]) << "shape " << shape << ", level " << level;
+      }
+   }
+}
+
+TEST(WavetableBankTest, LoudestLevelPeaksAtOneWithoutOffset)
+{
+   juce::SharedResourcePointer<WavetableBank> bank;
+   for (int shape = 0; shape < WavetableBank::NUM_SHAPES; ++shape)
+   {
+      // Band-limited edges ring, so the level with the fewest harmonics may be the loudest
+      const auto &table = bank->get(static_cast<WavetableBank::Shape>(shape));
+      float loudest = 0.f;
+      for (int level = 0; level < table.getNumLevels(); ++level)
+      {
+         const float *samples = table.getSamples(level);
+         double sum = 0.0;
+         float peak = 0.f;
+         for (int i = 0; i < table.getSize(); ++i)
+         {
+            sum += samples[i];
+            peak = std::max(peak, std::abs(samples[i]));
+         }
+         EXPECT_LE(peak, 1.f + 1e-5f) << "shape " << shape << ", level " << level;
+         EXPECT_NEAR(sum / table.getSize(), 0.0, 1e-5) << "shape " << shape << ", level " << level;
+         loudest = std::max(loudest, peak);
+      }
+      EXPECT_NEAR(loudest, 1.f, 1e-5f) << "shape " << shape;
+   }
+}
+
+TEST(WavetableBankTest, ChoosesTheRichestLevelThatDoesNotAlias)
+{
+   juce::SharedResourcePointer<WavetableBank> bank;
+   const auto &table = bank->get(WavetableBank::Saw);
+   ASSERT_EQ(table.getNumLevels(), 11);
+
+   // Level k may skip up to 2^k samples per output sample
+   EXPECT_EQ(table.getLevelFor(0.25f), 0);
+   EXPECT_EQ(table.getLevelFor(1.f), 0);
+   EXPECT_EQ(table.getLevelFor(1.5f), 1);
+   EXPECT_EQ(table.getLevelFor(2.f), 1);
+   EXPECT_EQ(table.getLevelFor(3.f), 2);
+   EXPECT_EQ(table.getLevelFor(4.f), 2);
+   EXPECT_EQ(table.getLevelFor(100.f), 7);
+   EXPECT_EQ(table.getLevelFor(1.0e6f), table.getNumLevels() - 1);
+}
+
+TEST(WavetableBankTest, EachLevelStopsAtItsHighestHarmonic)
+{
+   juce::SharedResourcePointer<WavetableBank> bank;
+   const auto &table = bank->get(WavetableBank::Saw);
+   const int size = table.getSize();
+   const int order = static_cast<int>(std::log2(size));
+   juce::dsp::FFT fft(order);
+
+   for (int level = 1; level < table.getNumLevels(); ++level)
+   {
+      std::vector<float> spectrum(2 * static_cast<size_t>(size), 0.f);
+      std::copy(table.getSamples(level), table.getSamples(level) + size, spectrum.begin());
+      fft.performRealOnlyForwardTransform(spectrum.data());
+      auto amplitude = [&spectrum, size](int harmonic)
+      {
+         return std::hypot(spectrum[2 * static_cast<size_t>(harmonic)], spectrum[2 * static_cast<size_t>(harmonic) + 1]) * 2.f / static_cast<float>(size);
+      };
+
+      // A saw has every harmonic, so the highest kept one is there and all above it are gone
+      const int highest = (size / 2) >> level;
+      EXPECT_GT(amplitude(highest), 1e-4f) << "level " << level;
+      float above = 0.f;
+      for (int harmonic = highest + 1; harmonic <= size / 2; ++harmonic)
+         above = std::max(above, amplitude(harmonic));
+      EXPECT_LT(above, 1e-5f) << "level " << level;
+   }
+}
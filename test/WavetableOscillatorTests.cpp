@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include <JuceHeader.h>
+#include <vector>
+
+#include "synth/WavetableBank.h"
+#include "synth/WavetableOscillator.h"
+
+namespace
+{
+   constexpr double sampleRate = 48000.0;
+   constexpr int numSamples = 515; // not a multiple of four, so the scalar tail runs too
+
+   // One call of numSamples takes the vector path; one sample per call takes only the scalar one
+   void expectPathsAgree(const Wavetable &table, float frequency, float startGain, float endGain)
+   {
+      WavetableOscillator vector(table, sampleRate), scalar(table, sampleRate);
+      vector.setFrequency(frequency);
+      scalar.setFrequency(frequency);
+
+      std::vector<float> block(numSamples, 0.f), single(numSamples, 0.f);
+      vector.renderBlock(block.data(), numSamples, startGain, endGain);
+      const float slope = (endGain - startGain) / numSamples;
+      for (int s = 0; s < numSamples; ++s)
+         scalar.renderBlock(single.data() + s, 1, startGain + slope * s, startGain + slope * (s + 1));
+
+      for (int s = 0; s < numSamples; ++s)
+         ASSERT_NEAR(block[s], single[s], 1e-5f) << frequency << " Hz, sample " << s;
+   }
+}
+
+TEST(WavetableOscillatorTest, VectorAndScalarPathsAgree)
+{
+   juce::SharedResourcePointer<WavetableBank> bank;
+   for (int shape = 0; shape < WavetableBank::NUM_SHAPES; ++shape)
+   {
+      const auto &table = bank->get(static_cast<WavetableBank::Shape>(shape));
+      for (float frequency : {27.5f, 440.f, 3520.f, 23000.f})
+         expectPathsAgree(table, frequency, 1.f, 1.f);
+   }
+}
+
+TEST(WavetableOscillatorTest, VectorAndScalarPathsAgreeOnAGainRamp)
+{
+   juce::SharedResourcePointer<WavetableBank> bank;
+   expectPathsAgree(bank->get(WavetableBank::Saw), 440.f, 0.f, 1.f);
+   expectPathsAgree(bank->get(WavetableBank::Sine), 1000.f, 0.8f, 0.1f);
+}
+
+TEST(WavetableOscillatorTest, AddsToTheOutput)
+{
+   juce::SharedResourcePointer<WavetableBank> bank;
+   WavetableOscillator oscillator(bank->get(WavetableBank::Sine), sampleRate);
+   oscillator.setFrequency(sampleRate / 4);
+
+   // A quarter of the sample rate lands exactly on 0, 1, 0, -1
+   std::vector<float> output(8, 0.5f);
+   oscillator.renderBlock(output.data(), 8, 1.f, 1.f);
+   const float expected[] = {0.5f, 1.5f, 0.5f, -0.5f, 0.5f, 1.5f, 0.5f, -0.5f};
+   for (int s = 0; s < 8; ++s)
+      EXPECT_NEAR(output[s], expected[s], 1e-5f) << "sample " << s;
+}
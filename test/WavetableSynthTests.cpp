@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <JuceHeader.h>
+#include <algorithm>
+#include <initializer_list>
+#include <vector>
+
+#include "synth/WavetableSynth.h"
+
+namespace
+{
+   constexpr double sampleRate = 48000.0;
+   constexpr int blockSize = 64;
+
+   // Sends messages at the start of one block, then renders blocks in all
+   void play(WavetableSynth &synth, std::initializer_list<juce::MidiMessage> messages, int blocks = 1)
+   {
+      juce::AudioBuffer<float> buffer(2, blockSize);
+      juce::MidiBuffer midi;
+      for (const auto &message : messages)
+         midi.addEvent(message, 0);
+
+      for (int b = 0; b < blocks; ++b)
+      {
+         buffer.clear();
+         synth.processBlock(buffer, midi);
+         midi.clear();
+      }
+   }
+
+   std::vector<int> activeNotes(const WavetableSynth &synth)
+   {
+      std::vector<int> notes;
+      for (int i = 0; i < synth.getNumActiveVoices(); ++i)
+         notes.push_back(synth.getActiveVoice(i).note);
+      std::sort(notes.begin(), notes.end());
+      return notes;
+   }
+
+   juce::MidiMessage on(int note, float velocity) { return juce::MidiMessage::noteOn(1, note, velocity); }
+   juce::MidiMessage off(int note) { return juce::MidiMessage::noteOff(1, note); }
+}
+
+TEST(WavetableSynthTest, StealsTheOldestVoice)
+{
+   WavetableSynth synth;
+   synth.prepareToPlay(sampleRate, 2);
+   synth.setVoiceStealing(WavetableSynth::VoiceStealing::Oldest);
+
+   play(synth, {on(60, 0.2f)});
+   play(synth, {on(61, 1.f)}, 20);
+   EXPECT_EQ(activeNotes(synth), (std::vector<int>{60, 61}));
+
+   play(synth, {on(62, 1.f)});
+   EXPECT_EQ(activeNotes(synth), (std::vector<int>{61, 62}));
+}
+
+TEST(WavetableSynthTest, StealsTheQuietestVoice)
+{
+   WavetableSynth synth;
+   synth.prepareToPlay(sampleRate, 2);
+   synth.setVoiceStealing(WavetableSynth::VoiceStealing::Quietest);
+
+   // The older note is the louder one, so oldest and quietest disagree
+   play(synth, {on(60, 1.f)});
+   play(synth, {on(61, 0.2f)}, 20);
+   play(synth, {on(62, 1.f)});
+   EXPECT_EQ(activeNotes(synth), (std::vector<int>{60, 62}));
+}
+
+TEST(WavetableSynthTest, StealsReleasedVoicesFirst)
+{
+   WavetableSynth synth;
+   synth.prepareToPlay(sampleRate, 2);
+   synth.setVoiceStealing(WavetableSynth::VoiceStealing::Oldest);
+
+   play(synth, {on(60, 1.f)});
+   play(synth, {on(61, 1.f)}, 20);
+   play(synth, {off(61)});
+   ASSERT_EQ(synth.getNumActiveVoices(), 2); // still fading out
+
+   play(synth, {on(62, 1.f)});
+   EXPECT_EQ(activeNotes(synth), (std::vector<int>{60, 62}));
+}
+
+TEST(WavetableSynthTest, RepeatedNoteReleasesOldestVoiceFirst)
+{
+   WavetableSynth synth;
+   synth.prepareToPlay(sampleRate, 4);
+
+   // Velocity tells the two voices apart: the older one settles at the higher level
+   play(synth, {on(60, 1.f)});
+   play(synth, {on(60, 0.5f)}, 20);
+   ASSERT_EQ(activeNotes(synth), (std::vector<int>{60, 60}));
+
+   play(synth, {off(60)});
+   float released = -1.f, held = -1.f;
+   for (int i = 0; i < synth.getNumActiveVoices(); ++i)
+   {
+      const auto voice = synth.getActiveVoice(i);
+      (voice.stage == VoiceEnvelopes::Release ? released : held) = voice.level;
+   }
+   EXPECT_GE(held, 0.f);
+   EXPECT_GT(released, held);
+
+   play(synth, {off(60)});
+   for (int i = 0; i < synth.getNumActiveVoices(); ++i)
+      EXPECT_EQ(synth.getActiveVoice(i).stage, VoiceEnvelopes::Release);
+}
+
+TEST(WavetableSynthTest, RetiresVoicesOnceTheirReleaseDiesAway)
+{
+   WavetableSynth synth;
+   synth.prepareToPlay(sampleRate, 4);
+   synth.setEnvelope({0.005f, 0.1f, 0.5f, 0.05f});
+
+   play(synth, {on(60, 1.f), on(64, 1.f)}, 10);
+   play(synth, {off(60)});
+   ASSERT_EQ(synth.getNumActiveVoices(), 2);
+
+   // 50 ms to fall by 60 dB is 2400 samples; a held note stays however long it is held
+   play(synth, {}, 60);
+   EXPECT_EQ(activeNotes(synth), (std::vector<int>{64}));
+
+   play(synth, {off(64)}, 60);
+   EXPECT_EQ(synth.getNumActiveVoices(), 0);
+
+   juce::AudioBuffer<float> buffer(2, blockSize);
+   juce::MidiBuffer midi;
+   buffer.clear();
+   synth.processBlock(buffer, midi);
+   EXPECT_EQ(buffer.getMagnitude(0, 0, blockSize), 0.f);
+}
+
+TEST(WavetableSynthTest, EachNoteOnKeepsItsOwnFilter)
+{
+   WavetableSynth synth;
+   synth.prepareToPlay(sampleRate, 4);
+   synth.setEnvelope({0.001f, 0.3f, 1.f, 0.3f});
+
+   // Two impacts on one note in one block: the first wide open, the second shut down to 20 Hz
+   synth.setNoteFilter(60, 0, 0.f, 0.f);
+   synth.setNoteFilter(60, 32, -10.f, 0.f);
+   juce::AudioBuffer<float> buffer(2, blockSize);
+   juce::MidiBuffer midi;
+   midi.addEvent(on(60, 1.f), 0);
+   midi.addEvent(on(60, 1.f), 32);
+   buffer.clear();
+   synth.processBlock(buffer, midi);
+
+   // Only the first note sounds before sample 32, through its own open filter
+   EXPECT_GT(buffer.getMagnitude(0, 0, 32), 0.05f);
+}